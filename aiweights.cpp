@@ -0,0 +1,32 @@
+#include "aiweights.h"
+
+using namespace std;
+
+//it is built at compile time, so it is ready before any static constructor asks for it
+static constinit const AIWeights defaultWeights;
+
+//it starts every thread on the defaults without running anything when the thread starts
+static constinit thread_local const AIWeights* activeWeights = &defaultWeights;
+
+const AIWeights& AIWeights::defaults() {
+    return defaultWeights;
+}
+
+const AIWeights& AIWeights::active() {
+    return *activeWeights;
+}
+
+int AIWeights::find(const string& name) {
+    for (int w = 0; w < AI_WEIGHT_COUNT; w++) {
+        if (name == AI_WEIGHT_NAMES[w]) return w;
+    }
+    return -1;
+}
+
+AIWeights::Scope::Scope(const AIWeights& weights) : previous(activeWeights) {
+    activeWeights = &weights;
+}
+
+AIWeights::Scope::~Scope() {
+    activeWeights = previous;
+}
@@ -0,0 +1,53 @@
+#ifndef AIWEIGHTS_H
+#define AIWEIGHTS_H
+
+#include <string>
+#include "scoretables.h"
+
+//it is a weight vector the AI scores with and the utility table built from it, so a lookup is still one load
+//the AI reads the weights of the calling thread, which are the defaults until a Scope gives it others,
+//so every thread and every seat of a game can play with its own weights without passing them down every call
+class AIWeights {
+private:
+    AIWeightVector values;
+    UtilityTable utility;
+
+public:
+    constexpr explicit AIWeights(const AIWeightVector& weights = DEFAULT_AI_WEIGHTS)
+        : values(weights), utility(makeUtilityTable(weights)) {}
+
+    double operator[](AIWeightId id) const { return values[id]; }
+    const AIWeightVector& getValues() const { return values; }
+
+    //it is cardUtilityLookup for these weights
+    double cardUtility(cardValue type, int handSize, int opponentHandSize) const {
+        return utility[type][utilityHandBucket(handSize)][opponentHandBucket(opponentHandSize)];
+    }
+
+    //it gets the weights built from DEFAULT_AI_WEIGHTS
+    static const AIWeights& defaults();
+
+    //it gets the weights the calling thread plays with
+    static const AIWeights& active();
+
+    //it checks if the calling thread plays with the default weights, which is what the decision cache stores
+    static bool usingDefaults() { return &active() == &defaults(); }
+
+    //it finds a weight by its name in AI_WEIGHT_NAMES or returns -1
+    static int find(const std::string& name);
+
+    //it makes the calling thread play with other weights until it goes out of scope
+    //the weights must outlive the scope, and scopes must end in the reverse order they were made
+    class Scope {
+    private:
+        const AIWeights* previous;
+
+    public:
+        explicit Scope(const AIWeights& weights);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+#endif
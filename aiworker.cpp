@@ -0,0 +1,98 @@
+#include "aiworker.h"
+#include "strategy.h"
+
+using namespace std;
+
+AIWorker::AIWorker()
+    : jobSeed(0), hasJob(false), stopping(false), generation(0),
+      pending(false), resultReady(false), result(-1), fallback(-1) {
+    thread = std::thread(&AIWorker::run, this);
+}
+
+//it lets the search that is running finish, since the strategies can not be stopped halfway
+AIWorker::~AIWorker() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void AIWorker::request(const Game& game, unsigned int seed, double deadlineSeconds) {
+    //it copies the game and works out the fallback before taking the lock so the worker thread is never held up
+    Game copy = game;
+    int greedyMove = chooseMoveWith(GreedyStrategy(), copy, seed);
+
+    {
+        lock_guard<mutex> guard(lock);
+        job = move(copy);
+        jobSeed = seed;
+        hasJob = true;
+        generation++;
+        pending = true;
+        resultReady = false;
+        fallback = greedyMove;
+        deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+                       chrono::duration<double>(deadlineSeconds));
+    }
+    wake.notify_one();
+}
+
+bool AIWorker::poll(int& cardToPlay) {
+    lock_guard<mutex> guard(lock);
+    if (!pending) {
+        return false;
+    }
+    if (resultReady) {
+        cardToPlay = result;
+    }
+    else if (chrono::steady_clock::now() >= deadline) {
+        cardToPlay = fallback;
+        generation++; //it drops the answer of the search that ran late
+    }
+    else {
+        return false;
+    }
+    pending = false;
+    resultReady = false;
+    return true;
+}
+
+void AIWorker::cancel() {
+    lock_guard<mutex> guard(lock);
+    hasJob = false;
+    pending = false;
+    resultReady = false;
+    generation++;
+}
+
+bool AIWorker::isPending() {
+    lock_guard<mutex> guard(lock);
+    return pending;
+}
+
+//it waits for a job, works it out without the lock, and keeps the answer only if nothing newer came in
+void AIWorker::run() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || hasJob; });
+        if (stopping) {
+            return;
+        }
+
+        Game game = move(job);
+        unsigned int seed = jobSeed;
+        uint64_t jobGeneration = generation;
+        hasJob = false;
+
+        guard.unlock();
+        int cardToPlay = StrategyRegistry::instance().chooseMove(game, seed);
+        guard.lock();
+
+        if (jobGeneration == generation && pending) {
+            result = cardToPlay;
+            resultReady = true;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef AIWORKER_H
+#define AIWORKER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "deck.h"
+
+//it works out AI moves on a background thread so the window keeps drawing while the AI thinks
+//the main loop hands it a copy of the game with request and checks poll once a frame
+//if the move is not ready by the deadline, poll gives the greedy move that request worked out up front
+class AIWorker {
+private:
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+
+    Game job;                 //it is the copy of the game the worker thread picks up next
+    unsigned int jobSeed;
+    bool hasJob;              //it is true until the worker thread takes the job
+    bool stopping;
+
+    uint64_t generation;      //it goes up with every request and cancel so a late answer is thrown away
+    bool pending;             //it is true from request until poll gives back a move
+    bool resultReady;
+    int result;
+    int fallback;             //it is the greedy move for when the deadline passes
+    std::chrono::steady_clock::time_point deadline;
+
+    void run();
+
+public:
+    AIWorker();
+    ~AIWorker();
+    AIWorker(const AIWorker&) = delete;
+    AIWorker& operator=(const AIWorker&) = delete;
+
+    //it starts working out the current players move on a copy of the game, dropping any request before it
+    void request(const Game& game, unsigned int seed, double deadlineSeconds);
+
+    //it gives the move once it is ready or the deadline has passed, and returns false while it is still thinking
+    bool poll(int& cardToPlay);
+
+    //it forgets the request, for when the game is restarted under it
+    void cancel();
+
+    //it checks if a request is waiting to be polled
+    bool isPending();
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include "batchgame.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+using namespace std;
+
+//it is the full deck packed in the order Deck::initinialize builds it, before the shuffle
+static array<uint8_t, DECK_SIZE> makeOrderedDeck() {
+    array<uint8_t, DECK_SIZE> cards{};
+    int n = 0;
+    for (int color = REDS; color <= YELLOWS; color++) {
+        cards[n++] = Card{ static_cast<cardColor>(color), ZERO }.pack();
+        for (int num = ONE; num <= NINE; num++) {
+            cards[n++] = Card{ static_cast<cardColor>(color), static_cast<cardValue>(num) }.pack();
+            cards[n++] = Card{ static_cast<cardColor>(color), static_cast<cardValue>(num) }.pack();
+        }
+        for (cardValue action : { SKIP, SKIP, REVERSE, REVERSE, DRAW_TWO, DRAW_TWO }) {
+            cards[n++] = Card{ static_cast<cardColor>(color), action }.pack();
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        cards[n++] = Card{ WILDS, WILD }.pack();
+        cards[n++] = Card{ WILDS, WILD_DRAW_FOUR }.pack();
+    }
+    return cards;
+}
+
+static const array<uint8_t, DECK_SIZE> ORDERED_DECK = makeOrderedDeck();
+
+//it is the mask of the slots that can be played on each packed top card
+static array<uint64_t, 256> makePlayableMasks() {
+    array<uint64_t, 256> masks{};
+    for (int packed = 0; packed < 256; packed++) {
+        Card top = Card::unpack(packed);
+        if (top.color <= WILDS && top.type <= WILD_DRAW_FOUR) {
+            masks[packed] = HandCounts::playableMask(top);
+        }
+    }
+    return masks;
+}
+
+static const array<uint64_t, 256> PLAYABLE_MASKS = makePlayableMasks();
+
+//it is the slots that can be played onto a draw stack
+const uint64_t DRAW_CARD_MASK = HandCounts::typeMask(DRAW_TWO) | HandCounts::typeMask(WILD_DRAW_FOUR);
+
+//it is what each card type adds to the draw stack
+const uint8_t STACK_ADDED[15] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 4 };
+
+//it is the slot of a packed card
+static int slotOfPacked(uint8_t packed) {
+    return HandCounts::slotOf(Card::unpack(packed));
+}
+
+//it is a packed random card the way Deck::draw makes one in infinite mode
+static uint8_t randomCard(FastRng& rng) {
+    Card card;
+    card.type = cardValue(rng.below(15));
+    card.color = card.isWild() ? WILDS : cardColor(rng.below(4));
+    return card.pack();
+}
+
+BatchGames::BatchGames(int games, int seats, bool infiniteDeck)
+    : numGames(games), numSeats(max(1, min(seats, MAX_SEATS))), infinite(infiniteDeck),
+      handCounts(games * numSeats * HAND_SLOTS, 0), handMasks(games * numSeats, 0),
+      handColors(games * numSeats * 4, 0), handSizes(games * numSeats, 0),
+      topCards(games, 0), currentSeats(games, 0), clockwise(games, 1), drawStacks(games, 0),
+      states(games, GAME_MENU), winners(games, -1), turns(games, 0),
+      pileCards(games * DECK_SIZE, 0), pileSizes(games, 0), discardCards(games * DECK_SIZE, 0), discardSizes(games, 0),
+      deckRngs(games), policyRngs(games), moveBuffer(games, BATCH_DRAW_MOVE) {
+    active.reserve(games);
+}
+
+void BatchGames::addToHand(int game, int seat, uint8_t packed) {
+    int hand = game * numSeats + seat;
+    int slot = slotOfPacked(packed);
+    handCounts[hand * HAND_SLOTS + slot]++;
+    handMasks[hand] |= 1ULL << slot;
+    int color = packed >> 4;
+    if (color != WILDS) handColors[hand * 4 + color]++;
+    handSizes[hand]++;
+}
+
+//it reshuffles the discard pile into the draw pile like Deck::recycleFrom when the pile runs out
+bool BatchGames::drawCard(int game, uint8_t& packed) {
+    FastRng& rng = deckRngs[game];
+    if (infinite) {
+        packed = randomCard(rng);
+        return true;
+    }
+
+    uint8_t* pile = &pileCards[game * DECK_SIZE];
+    if (pileSizes[game] == 0) {
+        int count = discardSizes[game];
+        if (count == 0) {
+            return false;
+        }
+        const uint8_t* discard = &discardCards[game * DECK_SIZE];
+        for (int i = 0; i < count; i++) {
+            //it clears the color that was chosen for a played wild
+            uint8_t type = discard[i] & 0x0F;
+            pile[i] = type >= WILD ? Card{ WILDS, static_cast<cardValue>(type) }.pack() : discard[i];
+        }
+        for (int i = count - 1; i > 0; i--) {
+            swap(pile[i], pile[rng.below(i + 1)]);
+        }
+        pileSizes[game] = count;
+        discardSizes[game] = 0;
+    }
+    packed = pile[--pileSizes[game]];
+    return true;
+}
+
+void BatchGames::reset(int game, unsigned int seed) {
+    if (states[game] != GAME_PLAYING) {
+        active.push_back(game);
+    }
+
+    //it splits the generators the same way Game::initialize does so the same seed gives the same deck
+    FastRng generator(seed);
+    deckRngs[game] = generator.split();
+    policyRngs[game] = generator;
+
+    //it shuffles a full deck even in infinite mode since Deck::initinialize does too
+    FastRng& rng = deckRngs[game];
+    uint8_t* pile = &pileCards[game * DECK_SIZE];
+    copy(ORDERED_DECK.begin(), ORDERED_DECK.end(), pile);
+    for (int i = DECK_SIZE - 1; i > 0; i--) {
+        swap(pile[i], pile[rng.below(i + 1)]);
+    }
+    pileSizes[game] = DECK_SIZE;
+    discardSizes[game] = 0;
+
+    int firstHand = game * numSeats;
+    fill_n(&handCounts[firstHand * HAND_SLOTS], numSeats * HAND_SLOTS, 0);
+    fill_n(&handMasks[firstHand], numSeats, 0);
+    fill_n(&handColors[firstHand * 4], numSeats * 4, 0);
+    fill_n(&handSizes[firstHand], numSeats, 0);
+    currentSeats[game] = 0;
+    clockwise[game] = 1;
+    drawStacks[game] = 0;
+    states[game] = GAME_PLAYING;
+    winners[game] = -1;
+    turns[game] = 0;
+
+    //it deals 7 cards to each seat one round at a time
+    for (int i = 0; i < 7; i++) {
+        for (int seat = 0; seat < numSeats; seat++) {
+            uint8_t packed;
+            if (drawCard(game, packed)) {
+                addToHand(game, seat, packed);
+            }
+        }
+    }
+
+    //it turns cards over until one is a number card, putting the others on the discard pile
+    while (true) {
+        uint8_t packed = infinite ? randomCard(rng) : pile[--pileSizes[game]];
+        Card card = Card::unpack(packed);
+        if (!card.isWild() && !card.isActionCard()) {
+            topCards[game] = packed;
+            break;
+        }
+        if (!infinite) discardCards[game * DECK_SIZE + discardSizes[game]++] = packed;
+    }
+}
+
+void BatchGames::resetAll(unsigned int firstSeed) {
+    for (int game = 0; game < numGames; game++) {
+        reset(game, firstSeed + game);
+    }
+}
+
+//it works out every mask with the same few bit operations and no branches
+void BatchGames::legalMasks(uint64_t* masks) const {
+    for (int game = 0; game < numGames; game++) {
+        uint64_t held = handMasks[game * numSeats + currentSeats[game]];
+        uint64_t stackMask = drawStacks[game] > 0 ? DRAW_CARD_MASK : ~0ULL;
+        uint64_t playing = 0ULL - (uint64_t)(states[game] == GAME_PLAYING);
+        masks[game] = held & PLAYABLE_MASKS[topCards[game]] & stackMask & playing;
+    }
+}
+
+void BatchGames::stepGame(int game, int move) {
+    if (states[game] != GAME_PLAYING) {
+        return;
+    }
+
+    int seat = currentSeats[game];
+    int hand = game * numSeats + seat;
+    int seatStep = clockwise[game] ? 1 : numSeats - 1;
+
+    //it draws the whole stack and passes, or draws one card and keeps the turn if that card can be played
+    if (move == BATCH_DRAW_MOVE) {
+        bool advance = true;
+        uint8_t packed;
+        if (drawStacks[game] > 0) {
+            for (int i = 0; i < drawStacks[game] && drawCard(game, packed); i++) {
+                addToHand(game, seat, packed);
+            }
+            drawStacks[game] = 0;
+        }
+        else if (drawCard(game, packed)) {
+            addToHand(game, seat, packed);
+            advance = ((PLAYABLE_MASKS[topCards[game]] >> slotOfPacked(packed)) & 1) == 0;
+        }
+        currentSeats[game] = (seat + advance * seatStep) % numSeats;
+        turns[game]++;
+        return;
+    }
+
+    //it ignores a move Game::playTurn would not take
+    uint64_t stackMask = drawStacks[game] > 0 ? DRAW_CARD_MASK : ~0ULL;
+    if (move < 0 || move >= HAND_SLOTS ||
+        ((handMasks[hand] & PLAYABLE_MASKS[topCards[game]] & stackMask) >> move & 1) == 0) {
+        return;
+    }
+
+    Card played = HandCounts::cardOf(move);
+    if (--handCounts[hand * HAND_SLOTS + move] == 0) handMasks[hand] &= ~(1ULL << move);
+    if (played.color != WILDS) handColors[hand * 4 + played.color]--;
+    handSizes[hand]--;
+    if (!infinite) discardCards[game * DECK_SIZE + discardSizes[game]++] = topCards[game];
+    turns[game]++;
+
+    if (handSizes[hand] == 0) {
+        topCards[game] = played.pack();
+        winners[game] = seat;
+        states[game] = GAME_OVER;
+        return;
+    }
+
+    //it applies the action card from tables: a reverse flips the direction first and also skips with two seats,
+    //and a skip moves one seat further the same way Game::playTurn calls nextPlayer twice
+    bool reverse = played.type == REVERSE;
+    clockwise[game] ^= (uint8_t)reverse;
+    seatStep = clockwise[game] ? 1 : numSeats - 1;
+    int seatsMoved = 1 + (played.type == SKIP) + (reverse && numSeats == 2);
+    drawStacks[game] += STACK_ADDED[played.type];
+
+    //it gives a wild the color the mover holds most of, red on a tie with none, like HandCounts::bestColor
+    if (played.isWild()) {
+        const uint8_t* colors = &handColors[hand * 4];
+        int best = REDS;
+        for (int c = REDS + 1; c <= YELLOWS; c++) best = colors[c] > colors[best] ? c : best;
+        played.colorChange(static_cast<cardColor>(best));
+    }
+    topCards[game] = played.pack();
+    currentSeats[game] = (seat + seatsMoved * seatStep) % numSeats;
+}
+
+void BatchGames::step(const int* moves) {
+    for (int game : active) {
+        stepGame(game, moves[game]);
+    }
+    active.erase(remove_if(active.begin(), active.end(), [this](int game) { return states[game] != GAME_PLAYING; }),
+                 active.end());
+}
+
+void BatchGames::stepRandom() {
+    for (int game : active) {
+        uint64_t stackMask = drawStacks[game] > 0 ? DRAW_CARD_MASK : ~0ULL;
+        uint64_t mask = handMasks[game * numSeats + currentSeats[game]] & PLAYABLE_MASKS[topCards[game]] & stackMask;
+        int choices = popcount(mask);
+        int pick = policyRngs[game].below(choices + 1);
+        for (int i = 0; i < pick && i < choices; i++) mask &= mask - 1;
+        moveBuffer[game] = pick == choices ? BATCH_DRAW_MOVE : countr_zero(mask);
+    }
+    step(moveBuffer.data());
+}
+
+int BatchGames::playRandom(int maxTurns) {
+    int before = active.size();
+    for (int turn = 0; turn < maxTurns && !active.empty(); turn++) {
+        stepRandom();
+    }
+    return before - active.size();
+}
@@ -0,0 +1,97 @@
+#ifndef BATCHGAME_H
+#define BATCHGAME_H
+
+#include <cstdint>
+#include <vector>
+#include "deck.h"
+
+//it is the move that draws instead of playing a slot
+const int BATCH_DRAW_MOVE = SNAPSHOT_DRAW_MOVE;
+
+//it plays thousands of independent self-play games in lockstep, one move for every unfinished game per step
+//every field is its own flat array indexed by game (and seat), so a step walks each array in order
+//instead of chasing the vectors of one Game and its Players per table
+//it follows the rules of Game::playTurn for a table where every seat is an AI, so each wild takes the color
+//the mover holds most of, and the same seed deals and draws the same cards as Game::initialize
+//the moves are hand slots like GameSnapshot, or BATCH_DRAW_MOVE, and a move Game would ignore is ignored
+class BatchGames {
+private:
+    int numGames;
+    int numSeats;
+    bool infinite;                     //it draws random cards like Deck in infinite mode
+
+    //they are the hands, at game * numSeats + seat
+    std::vector<uint8_t> handCounts;   //it is HAND_SLOTS counts per hand
+    std::vector<uint64_t> handMasks;   //it has bit s set when the hand holds slot s
+    std::vector<uint8_t> handColors;   //it is 4 color counts per hand for picking the color of a wild
+    std::vector<uint16_t> handSizes;
+
+    //they are the tables, at game
+    std::vector<uint8_t> topCards;     //it is the packed top card
+    std::vector<uint8_t> currentSeats;
+    std::vector<uint8_t> clockwise;
+    std::vector<uint16_t> drawStacks;  //it can pass 255 in infinite mode where draw cards never run out
+    std::vector<uint8_t> states;       //it is the GameState
+    std::vector<int8_t> winners;
+    std::vector<uint32_t> turns;
+
+    //they are the piles, at game * DECK_SIZE
+    std::vector<uint8_t> pileCards;    //it is the packed draw pile with the next card at pileSize - 1
+    std::vector<uint8_t> pileSizes;
+    std::vector<uint8_t> discardCards; //it is the packed discard pile in the order the cards were played
+    std::vector<uint8_t> discardSizes;
+
+    std::vector<FastRng> deckRngs;     //it is the generator of each deck, the same one Game::initialize gives its Deck
+    std::vector<FastRng> policyRngs;   //it is the generator playRandom picks moves with
+
+    std::vector<int> active;           //it is the games still being played
+    std::vector<int> moveBuffer;
+
+    //it draws one card off the pile of a game the way Game::drawFromDeck does and returns false if no card is left anywhere
+    bool drawCard(int game, uint8_t& packed);
+
+    void addToHand(int game, int seat, uint8_t packed);
+
+    //it plays one move of one game
+    void stepGame(int game, int move);
+
+public:
+    BatchGames(int numGames, int numSeats, bool infiniteDeck = false);
+
+    //it deals a game with a seed, the same way Game::initialize(numSeats, numSeats, seed) does
+    void reset(int game, unsigned int seed);
+
+    //it deals every game, giving game g the seed firstSeed + g
+    void resetAll(unsigned int firstSeed);
+
+    //it writes the mask of the slots the current seat can play for every game, 0 for a finished game
+    //drawing is always allowed while a game is being played so it is not in the mask
+    void legalMasks(uint64_t* masks) const;
+
+    //it plays moves[game] in every game that is still being played
+    void step(const int* moves);
+
+    //it plays a uniformly random legal move, counting the draw, in every game that is still being played
+    void stepRandom();
+
+    //it steps with random moves until every game is over or maxTurns steps were played, and returns the games that ended
+    int playRandom(int maxTurns);
+
+    int getNumGames() const { return numGames; }
+    int getNumSeats() const { return numSeats; }
+    int getActiveCount() const { return active.size(); }
+    GameState getState(int game) const { return static_cast<GameState>(states[game]); }
+    int getWinner(int game) const { return winners[game]; }
+    int getCurrentSeat(int game) const { return currentSeats[game]; }
+    bool isClockwise(int game) const { return clockwise[game] != 0; }
+    int getDrawStack(int game) const { return drawStacks[game]; }
+    Card getTopCard(int game) const { return Card::unpack(topCards[game]); }
+    int getTurns(int game) const { return turns[game]; }
+    int getPileSize(int game) const { return pileSizes[game]; }
+    int getDiscardSize(int game) const { return discardSizes[game]; }
+    int getHandSize(int game, int seat) const { return handSizes[game * numSeats + seat]; }
+    int getHandCount(int game, int seat, int slot) const { return handCounts[(game * numSeats + seat) * HAND_SLOTS + slot]; }
+    uint64_t getHandMask(int game, int seat) const { return handMasks[game * numSeats + seat]; }
+};
+
+#endif
@@ -0,0 +1,332 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "deck.h"
+#include "strategy.h"
+
+//it is the microbenchmark of the AI and game hot paths
+//usage: UnoBenchmark [--seed S] [--min-time ms] [--filter text] [--out file.json]
+//every benchmark builds its input from the seed so two runs of the same build measure the same work,
+//and the results are printed as JSON so they can be compared across versions
+using namespace std;
+
+//it is the range of hand sizes the hand benchmarks are run at, every size in between included
+const int MIN_BENCH_HAND_SIZE = 1;
+const int MAX_BENCH_HAND_SIZE = 30;
+
+//it is how many different inputs each benchmark cycles through so one lucky hand does not decide the result
+const int INPUT_VARIANTS = 64;
+
+//it is the result of one benchmark
+struct BenchResult {
+    string name;
+    int param;           //it is the hand size or player count, 0 when there is none
+    long long iterations;
+    double nsPerOp;
+};
+
+//it keeps results alive so the compiler can not drop the work that made them
+static volatile double benchSink = 0.0;
+
+//it is the settings shared by every benchmark
+struct BenchConfig {
+    unsigned int seed = 12345;
+    double minTimeMs = 200.0;
+    string filter;
+};
+
+//it times body(i) in batches that double until a batch takes minTimeMs, and keeps the best of three batches
+template <class F>
+BenchResult runBench(const BenchConfig& config, const string& name, int param, F&& body) {
+    long long iterations = 1;
+    double bestNs = 0.0;
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        for (long long i = 0; i < iterations; i++) body(i);
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (elapsedMs >= config.minTimeMs || iterations >= (1LL << 40)) {
+            bestNs = elapsedMs * 1e6 / iterations;
+            break;
+        }
+        iterations *= 2;
+    }
+    for (int repeat = 0; repeat < 2; repeat++) {
+        auto start = chrono::steady_clock::now();
+        for (long long i = 0; i < iterations; i++) body(i);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+        if (ns < bestNs) bestNs = ns;
+    }
+    cerr << name << " [" << param << "]: " << bestNs << " ns/op" << endl;
+    return { name, param, iterations, bestNs };
+}
+
+//it deals a random hand from a shuffled deck with a fixed seed
+static vector<Card> makeHand(int size, unsigned int seed) {
+    Deck deck(seed);
+    deck.initinialize();
+    vector<Card> hand;
+    Card card;
+    for (int i = 0; i < size && deck.draw(card); i++) {
+        hand.push_back(card);
+    }
+    return hand;
+}
+
+//it picks a top card that is not a wild the same way Game::initialize does
+static Card makeTopCard(unsigned int seed) {
+    FastRng rng(seed);
+    return { cardColor(rng.below(4)), cardValue(rng.below(10)) };
+}
+
+//it is one input of a hand benchmark
+struct HandInput {
+    vector<Card> hand;
+    Card topCard;
+    int opponentHandSize;
+};
+
+static vector<HandInput> makeInputs(int handSize, unsigned int seed) {
+    vector<HandInput> inputs;
+    for (int v = 0; v < INPUT_VARIANTS; v++) {
+        unsigned int inputSeed = seed + handSize * 1000 + v;
+        inputs.push_back({ makeHand(handSize, inputSeed), makeTopCard(inputSeed), 1 + v % 10 });
+    }
+    return inputs;
+}
+
+//it walks a chain of cards that can be played one after another, taking the first card that matches each time,
+//so evaluateSequence scores the whole chain instead of stopping at the first card that does not match
+//a hand with nothing to play on the top card starts its chain on its own first card
+static void makeChain(const HandInput& in, vector<int>& chain, Card& chainTop) {
+    chainTop = in.topCard;
+    chain.clear();
+    vector<bool> used(in.hand.size(), false);
+    Card current = chainTop;
+    while (true) {
+        int next = -1;
+        for (int c = 0; c < (int)in.hand.size() && next == -1; c++) {
+            if (!used[c] && in.hand[c].matches(current)) next = c;
+        }
+        if (next == -1 && chain.empty()) {
+            chainTop = in.hand[0];
+            current = chainTop;
+            continue;
+        }
+        if (next == -1) break;
+        used[next] = true;
+        chain.push_back(next);
+        current = in.hand[next];
+    }
+}
+
+//it checks if a benchmark should run under the --filter option
+static bool selected(const BenchConfig& config, const string& name) {
+    return config.filter.empty() || name.find(config.filter) != string::npos;
+}
+
+static void runHandBenchmarks(const BenchConfig& config, vector<BenchResult>& results) {
+    OpponentModel model;
+    for (int handSize = MIN_BENCH_HAND_SIZE; handSize <= MAX_BENCH_HAND_SIZE; handSize++) {
+        vector<HandInput> inputs = makeInputs(handSize, config.seed);
+
+        if (selected(config, "LPOptimizer::solveLPForBestCard")) {
+            results.push_back(runBench(config, "LPOptimizer::solveLPForBestCard", handSize, [&](long long i) {
+                const HandInput& in = inputs[i % INPUT_VARIANTS];
+                benchSink = benchSink + LPOptimizer::solveLPForBestCard(in.hand, in.topCard, in.hand.size(), in.opponentHandSize);
+            }));
+        }
+
+        if (selected(config, "LPOptimizer::solveLPMultiTurn")) {
+            results.push_back(runBench(config, "LPOptimizer::solveLPMultiTurn", handSize, [&](long long i) {
+                const HandInput& in = inputs[i % INPUT_VARIANTS];
+                benchSink = benchSink + LPOptimizer::solveLPMultiTurn(in.hand, in.topCard, in.hand.size(),
+                                                                      SeatView::headsUp(in.opponentHandSize, model), 3);
+            }));
+        }
+
+        if (selected(config, "LPOptimizer::planNextTurns")) {
+            results.push_back(runBench(config, "LPOptimizer::planNextTurns", handSize, [&](long long i) {
+                const HandInput& in = inputs[i % INPUT_VARIANTS];
+                benchSink = benchSink + LPOptimizer::planNextTurns(in.hand, in.topCard, SeatView::headsUp(in.opponentHandSize, model),
+                                                                   3).expectedUtility;
+            }));
+        }
+
+        if (selected(config, "LPOptimizer::evaluateSequence")) {
+            //it evaluates a chain that is legal all the way through for each input
+            vector<vector<int>> chains(INPUT_VARIANTS);
+            vector<Card> chainTops(INPUT_VARIANTS);
+            for (int v = 0; v < INPUT_VARIANTS; v++) {
+                makeChain(inputs[v], chains[v], chainTops[v]);
+            }
+            results.push_back(runBench(config, "LPOptimizer::evaluateSequence", handSize, [&](long long i) {
+                int v = i % INPUT_VARIANTS;
+                const HandInput& in = inputs[v];
+                benchSink = benchSink + LPOptimizer::evaluateSequence(in.hand, chains[v], chainTops[v],
+                                                                      SeatView::headsUp(in.opponentHandSize, model));
+            }));
+        }
+
+        if (selected(config, "Player::sortHand")) {
+            //it puts an unsorted hand back with setHand before every sort, so each op includes one setHand
+            Player player(true, "bench");
+            results.push_back(runBench(config, "Player::sortHand", handSize, [&](long long i) {
+                player.setHand(inputs[i % INPUT_VARIANTS].hand);
+                player.sortHand();
+                benchSink = benchSink + (int)player.getHand()[0].type;
+            }));
+        }
+
+        if (selected(config, "Player::canPlay")) {
+            vector<Player> players;
+            for (const HandInput& in : inputs) {
+                players.emplace_back(true, "bench");
+                players.back().setHand(in.hand);
+            }
+            results.push_back(runBench(config, "Player::canPlay", handSize, [&](long long i) {
+                int v = i % INPUT_VARIANTS;
+                benchSink = benchSink + players[v].canPlay(inputs[v].topCard);
+            }));
+        }
+    }
+}
+
+static void runDeckBenchmarks(const BenchConfig& config, vector<BenchResult>& results) {
+    if (selected(config, "Deck::initinialize")) {
+        Deck deck(config.seed);
+        results.push_back(runBench(config, "Deck::initinialize", 0, [&](long long) {
+            deck.initinialize();
+            benchSink = benchSink + deck.size();
+        }));
+    }
+
+    if (selected(config, "Deck::shuffle")) {
+        Deck deck(config.seed);
+        deck.initinialize();
+        results.push_back(runBench(config, "Deck::shuffle", 0, [&](long long) {
+            deck.shuffle();
+            benchSink = benchSink + deck.size();
+        }));
+    }
+}
+
+//it plays whole AI games with the default strategy, cycling through 1024 fixed game seeds
+static void runGameBenchmarks(const BenchConfig& config, vector<BenchResult>& results) {
+    if (!selected(config, "Game::fullGame")) return;
+
+    const StrategyRegistry& registry = StrategyRegistry::instance();
+    for (int numPlayers : { 2, 4 }) {
+        Game game;
+        results.push_back(runBench(config, "Game::fullGame", numPlayers, [&](long long i) {
+            unsigned int gameSeed = config.seed + (unsigned int)(i % 1024);
+            game.initialize(numPlayers, numPlayers, gameSeed);
+            for (int turn = 0; game.getState() == GAME_PLAYING && turn < 5000; turn++) {
+                game.playTurn(registry.chooseMove(game, gameSeed + turn));
+            }
+            benchSink = benchSink + game.getWinner();
+        }));
+    }
+}
+
+//it plays one legal move on a snapshot and takes it back, cycling through positions that random moves reached
+//from fixed game seeds, so each op is one legalMoves, one apply and one undo
+static void runSnapshotBenchmarks(const BenchConfig& config, vector<BenchResult>& results) {
+    if (!selected(config, "GameSnapshot::applyUndo")) return;
+
+    int moves[HAND_SLOTS + 1];
+    SnapshotUndo undo;
+    for (int numPlayers : { 2, 4 }) {
+        Game game;
+        vector<GameSnapshot> snapshots(INPUT_VARIANTS);
+        for (int v = 0; v < INPUT_VARIANTS; v++) {
+            GameSnapshot& snapshot = snapshots[v];
+            game.initialize(numPlayers, numPlayers, config.seed + v);
+            game.saveSnapshot(snapshot);
+            FastRng policy(config.seed + v);
+            for (int turn = 0; turn < v % 32; turn++) {
+                snapshot.apply(moves[policy.below(snapshot.legalMoves(moves))], undo);
+                if (snapshot.state != GAME_PLAYING) {
+                    snapshot.undo(undo);
+                    break;
+                }
+            }
+        }
+
+        results.push_back(runBench(config, "GameSnapshot::applyUndo", numPlayers, [&](long long i) {
+            GameSnapshot& snapshot = snapshots[i % INPUT_VARIANTS];
+            int count = snapshot.legalMoves(moves);
+            snapshot.apply(moves[(i / INPUT_VARIANTS) % count], undo);
+            snapshot.undo(undo);
+            benchSink = benchSink + snapshot.currentPlayer;
+        }));
+    }
+}
+
+//it writes the results as one JSON object
+static void writeJson(ostream& out, const BenchConfig& config, const vector<BenchResult>& results) {
+    out << "{\n";
+    out << "  \"seed\": " << config.seed << ",\n";
+    out << "  \"min_time_ms\": " << config.minTimeMs << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult& result = results[r];
+        out << "    { \"name\": \"" << result.name << "\", \"param\": " << result.param
+            << ", \"iterations\": " << result.iterations
+            << ", \"ns_per_op\": " << result.nsPerOp
+            << ", \"ops_per_sec\": " << (result.nsPerOp > 0.0 ? 1e9 / result.nsPerOp : 0.0) << " }"
+            << (r + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    string outPath;
+
+    for (int arg = 1; arg < argc; arg += 2) {
+        string option = argv[arg];
+        if (arg + 1 >= argc) {
+            cerr << option << " needs a value" << endl;
+            return 1;
+        }
+        if (option == "--seed") {
+            config.seed = strtoul(argv[arg + 1], nullptr, 10);
+        }
+        else if (option == "--min-time") {
+            config.minTimeMs = atof(argv[arg + 1]);
+        }
+        else if (option == "--filter") {
+            config.filter = argv[arg + 1];
+        }
+        else if (option == "--out") {
+            outPath = argv[arg + 1];
+        }
+        else {
+            cerr << "unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    vector<BenchResult> results;
+    runHandBenchmarks(config, results);
+    runDeckBenchmarks(config, results);
+    runGameBenchmarks(config, results);
+    runSnapshotBenchmarks(config, results);
+
+    if (outPath.empty()) {
+        writeJson(cout, config, results);
+    }
+    else {
+        ofstream out(outPath);
+        if (!out) {
+            cerr << "can not write " << outPath << endl;
+            return 1;
+        }
+        writeJson(out, config, results);
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "decisioncache.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include "scoretables.h"
+
+using namespace std;
+
+//it folds one more value into a key
+static uint64_t mixKey(uint64_t key, uint64_t value) {
+    uint64_t state = key ^ (value * 0xD6E8FEB86659FD93ULL);
+    return splitMix64(state);
+}
+
+//it is the random keys of the hand, summed over every held card so the order of the hand never matters
+struct DecisionHashKeys {
+    uint64_t slotKeys[HAND_SLOTS];
+
+    DecisionHashKeys() {
+        uint64_t state = 0xDEC1510CAC4EULL;
+        for (auto& key : slotKeys) key = splitMix64(state);
+    }
+};
+static const DecisionHashKeys decisionHashKeys;
+
+DecisionCache::DecisionCache() : setsPerShard(0), modelBuckets(DECISION_CACHE_MODEL_BUCKETS), enabled(false) {}
+
+//it gets the cache shared by the whole program
+DecisionCache& DecisionCache::instance() {
+    static DecisionCache cache;
+    return cache;
+}
+
+//it rounds the sets of each shard up to a power of two so a set is picked with a mask
+void DecisionCache::configure(size_t capacity, int buckets) {
+    enabled.store(false, memory_order_relaxed);
+    modelBuckets = max(0, buckets);
+    if (capacity == 0) {
+        shards.reset();
+        setsPerShard = 0;
+        return;
+    }
+
+    size_t sets = (capacity + DECISION_CACHE_SHARDS * DECISION_CACHE_WAYS - 1) / (DECISION_CACHE_SHARDS * DECISION_CACHE_WAYS);
+    setsPerShard = bit_ceil(max<size_t>(sets, 1));
+    shards.reset(new Shard[DECISION_CACHE_SHARDS]);
+    for (int s = 0; s < DECISION_CACHE_SHARDS; s++) {
+        shards[s].entries.assign(setsPerShard * DECISION_CACHE_WAYS, Entry{0, -1, 0});
+        shards[s].hands.assign(setsPerShard, 0);
+    }
+    enabled.store(true, memory_order_relaxed);
+}
+
+//it builds the key from only what the planner reads, so positions it can not tell apart share a key
+DecisionKey DecisionCache::keyOf(const HandCounts& hand, const Card& topCard, const SeatView& seats,
+                                 int turnsAhead) const {
+    //it rounds the chance of each color for every seat a card can hand the turn to, or keeps its exact bits with 0 buckets
+    const int CHANCES = 2 * HANDOFF_KINDS;
+    uint64_t modelBits[4][CHANCES];
+    for (int c = REDS; c <= YELLOWS; c++) {
+        for (int i = 0; i < CHANCES; i++) {
+            double chance = seats.answerHasColor[i / HANDOFF_KINDS][i % HANDOFF_KINDS][c];
+            if (modelBuckets > 0) {
+                modelBits[c][i] = min(modelBuckets - 1, max(0, (int)(chance * modelBuckets)));
+            }
+            else {
+                memcpy(&modelBits[c][i], &chance, sizeof(uint64_t));
+            }
+        }
+    }
+
+    //it puts the top color first and sorts the other colors by their row of counts and then their chances
+    //two colors that compare equal hold the same cards with the same chances, so either order gives the same key
+    DecisionKey result;
+    uint8_t order[4] = { REDS, BLUES, GREENS, YELLOWS };
+    int first = 0;
+    if (topCard.color != WILDS) {
+        swap(order[0], order[topCard.color]);
+        sort(order + 1, order + 4);
+        first = 1;
+    }
+    sort(order + first, order + 4, [&](uint8_t a, uint8_t b) {
+        int rows = memcmp(&hand.counts[a * COLORED_TYPES], &hand.counts[b * COLORED_TYPES], COLORED_TYPES);
+        if (rows != 0) return rows < 0;
+        return lexicographical_compare(modelBits[a], modelBits[a] + CHANCES, modelBits[b], modelBits[b] + CHANCES);
+    });
+    for (int c = 0; c < 4; c++) {
+        result.toActual[c] = order[c];
+        result.toCanonical[order[c]] = c;
+    }
+    result.toActual[WILDS] = WILDS;
+    result.toCanonical[WILDS] = WILDS;
+
+    uint64_t key = 0;
+    for (uint64_t held = hand.present; held; held &= held - 1) {
+        int slot = countr_zero(held);
+        key += decisionHashKeys.slotKeys[result.canonicalSlot(slot)] * hand.counts[slot];
+    }
+
+    //it keeps only the color of a wild top card, since every wild matches whatever the type
+    Card top = topCard;
+    if (top.isWild()) top.type = WILD;
+    top.color = static_cast<cardColor>(result.toCanonical[top.color]);
+    key = mixKey(key, top.pack());
+
+    key = mixKey(key, opponentHandBucket(seats.hitHandSize[0]));
+    key = mixKey(key, opponentHandBucket(seats.hitHandSize[1]));
+    key = mixKey(key, min({ turnsAhead, hand.total, MAX_PLAN_DEPTH }));
+
+    //it only reads the colors a played card can have, since a wild can never be blocked
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < CHANCES; i++) key = mixKey(key, modelBits[result.toActual[c]][i]);
+    }
+
+    result.key = key == 0 ? 1 : key; //it keeps 0 for empty entries
+    return result;
+}
+
+bool DecisionCache::lookup(uint64_t key, int& slot) {
+    if (!isEnabled()) return false;
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> guard(shard.lock);
+    Entry* set = &shard.entries[setFor(key) * DECISION_CACHE_WAYS];
+    for (int way = 0; way < DECISION_CACHE_WAYS; way++) {
+        if (set[way].key == key) {
+            set[way].referenced = 1;
+            slot = set[way].slot;
+            shard.hits++;
+            return true;
+        }
+    }
+    shard.misses++;
+    return false;
+}
+
+void DecisionCache::insert(uint64_t key, int slot) {
+    if (!isEnabled()) return;
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> guard(shard.lock);
+    size_t setIndex = setFor(key);
+    Entry* set = &shard.entries[setIndex * DECISION_CACHE_WAYS];
+
+    //it updates the entry when another thread stored the same position first, or fills an empty one
+    int target = -1;
+    for (int way = 0; way < DECISION_CACHE_WAYS && target == -1; way++) {
+        if (set[way].key == key) target = way;
+    }
+    for (int way = 0; way < DECISION_CACHE_WAYS && target == -1; way++) {
+        if (set[way].key == 0) {
+            target = way;
+            shard.used++;
+        }
+    }
+
+    //it sweeps the hand past the entries that were hit, clearing their bit, and evicts the first one that was not
+    if (target == -1) {
+        uint8_t& hand = shard.hands[setIndex];
+        while (set[hand].referenced) {
+            set[hand].referenced = 0;
+            hand = (hand + 1) % DECISION_CACHE_WAYS;
+        }
+        target = hand;
+        hand = (hand + 1) % DECISION_CACHE_WAYS;
+        shard.evictions++;
+    }
+
+    set[target] = Entry{ key, static_cast<int8_t>(slot), 0 };
+    shard.insertions++;
+}
+
+DecisionCacheStats DecisionCache::stats() {
+    DecisionCacheStats total = { 0, 0, 0, 0, 0, 0 };
+    if (!shards) return total;
+    for (int s = 0; s < DECISION_CACHE_SHARDS; s++) {
+        Shard& shard = shards[s];
+        lock_guard<mutex> guard(shard.lock);
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.insertions += shard.insertions;
+        total.evictions += shard.evictions;
+        total.entries += shard.used;
+        total.capacity += shard.entries.size();
+    }
+    return total;
+}
+
+//it writes the entries one shard at a time, so the other threads can keep using the cache meanwhile
+bool DecisionCache::save(const string& path) {
+    if (!isEnabled()) return false;
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    uint8_t header[12];
+    memcpy(header, DECISION_CACHE_MAGIC, 8);
+    for (int b = 0; b < 4; b++) header[8 + b] = (uint32_t)modelBuckets >> (8 * b);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    vector<uint8_t> buffer;
+    for (int s = 0; s < DECISION_CACHE_SHARDS && ok; s++) {
+        buffer.clear();
+        {
+            lock_guard<mutex> guard(shards[s].lock);
+            for (const Entry& entry : shards[s].entries) {
+                if (entry.key == 0) continue;
+                for (int b = 0; b < 8; b++) buffer.push_back(entry.key >> (8 * b));
+                buffer.push_back(static_cast<uint8_t>(entry.slot));
+            }
+        }
+        ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+bool DecisionCache::load(const string& path) {
+    if (!isEnabled()) return false;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    uint8_t header[12];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header)
+        && memcmp(header, DECISION_CACHE_MAGIC, 8) == 0;
+    uint32_t buckets = 0;
+    for (int b = 0; b < 4; b++) buckets |= (uint32_t)header[8 + b] << (8 * b);
+    ok = ok && (int)buckets == modelBuckets;
+
+    //it reads every entry first so a short file leaves the cache untouched
+    vector<uint8_t> data;
+    uint8_t chunk[1 << 16];
+    size_t read;
+    while (ok && (read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+    if (!ok || data.size() % 9 != 0) return false;
+
+    for (size_t at = 0; at < data.size(); at += 9) {
+        uint64_t key = 0;
+        for (int b = 0; b < 8; b++) key |= (uint64_t)data[at + b] << (8 * b);
+        int slot = static_cast<int8_t>(data[at + 8]);
+        if (key == 0 || slot < -1 || slot >= HAND_SLOTS) continue;
+        insert(key, slot);
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef DECISIONCACHE_H
+#define DECISIONCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "deck.h"
+
+//it is the decision cache file format
+//the file starts with the 8 byte DECISION_CACHE_MAGIC and the model bucket count as 4 bytes,
+//then every entry is the 8 byte key and the 1 byte slot (0xFF to draw), all little endian
+const char DECISION_CACHE_MAGIC[8] = { 'U', 'N', 'O', 'D', 'C', 'A', '0', '2' };
+
+//it is how many steps each color chance of the opponent model is rounded to, so close models share decisions
+const int DECISION_CACHE_MODEL_BUCKETS = 8;
+
+//it is how many entries share one set, which is what the CLOCK hand sweeps when a set is full
+const int DECISION_CACHE_WAYS = 8;
+
+//it is how many independently locked parts the table is split into
+const int DECISION_CACHE_SHARDS = 64;
+
+//it is the counters of the cache summed over every shard
+struct DecisionCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    size_t entries;
+    size_t capacity;
+
+    double hitRate() const { return hits + misses > 0 ? hits / (double)(hits + misses) : 0.0; }
+};
+
+//it is the canonical key of a position and the color relabeling that made it canonical
+//a slot is stored in the relabeled colors, so it is mapped back with toActual before it is played
+struct DecisionKey {
+    uint64_t key;
+    uint8_t toCanonical[5];  //it is the canonical color of each actual color, and WILDS stays WILDS
+    uint8_t toActual[5];     //it is the actual color of each canonical color
+
+    //it moves a slot between the actual and the canonical colors, leaving the draw (-1) and the wilds alone
+    static int relabel(int slot, const uint8_t* colorMap) {
+        if (slot < 0 || slot >= COLORED_TYPES * 4) return slot;
+        return colorMap[slot / COLORED_TYPES] * COLORED_TYPES + slot % COLORED_TYPES;
+    }
+    int canonicalSlot(int slot) const { return relabel(slot, toCanonical); }
+    int actualSlot(int slot) const { return relabel(slot, toActual); }
+};
+
+//it remembers the move chooseOptimalCardAdvanced picked for a position so the planner runs once per position
+//the key is canonical: the hand is its slot counts so the order of the cards does not matter, a wild top card
+//only keeps the color it was given, the hand of the seat hit in each direction only keeps the bucket
+//getCardUtility reads, and the seats a card can hand the turn to only keep each color chance rounded to
+//modelBuckets steps
+//the four colors play the same, so they are also relabeled: the top color becomes the first color and the
+//others are sorted by what the hand holds of them and the chances the other seats hold them
+//everything else the planner reads follows from those, so with 0 buckets (exact chances) a hit gives a move
+//the planner scores as high as its own pick, and with buckets the pick for a model at most one step away
+//the table is split into shards that each have a lock and a fixed array of sets, so memory never grows,
+//and a full set evicts with CLOCK: an entry that was hit since the hand last passed gets a second chance
+//one cache is shared by every thread of the program, so tournament threads and the game's AI thread
+//all fill and read the same table
+class DecisionCache {
+private:
+    //it is one remembered decision
+    struct Entry {
+        uint64_t key;        //it is 0 for an empty entry
+        int8_t slot;         //it is the slot to play or -1 to draw
+        uint8_t referenced;  //it is the CLOCK bit, set on every hit
+    };
+
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::vector<Entry> entries;   //it is sets of DECISION_CACHE_WAYS entries one after another
+        std::vector<uint8_t> hands;   //it is the CLOCK hand of each set
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        size_t used = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t setsPerShard;             //it is a power of two
+    int modelBuckets;
+    std::atomic<bool> enabled;
+
+    DecisionCache();
+
+    Shard& shardFor(uint64_t key) const { return shards[key >> 58]; }
+    size_t setFor(uint64_t key) const { return key & (setsPerShard - 1); }
+
+public:
+    //it gets the cache shared by the whole program, which starts disabled
+    static DecisionCache& instance();
+
+    //it sizes the cache for at least this many entries and empties it, where 0 disables it
+    //it must not be called while another thread uses the cache
+    void configure(size_t capacity, int buckets = DECISION_CACHE_MODEL_BUCKETS);
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    int getModelBuckets() const { return modelBuckets; }
+
+    //it builds the canonical key of a chooseOptimalCardAdvanced position
+    DecisionKey keyOf(const HandCounts& hand, const Card& topCard, const SeatView& seats, int turnsAhead) const;
+
+    //it finds the slot stored for a key and returns false on a miss
+    bool lookup(uint64_t key, int& slot);
+
+    //it stores the slot for a key, evicting with CLOCK when the set is full
+    void insert(uint64_t key, int slot);
+
+    //it sums the counters of every shard
+    DecisionCacheStats stats();
+
+    //it writes every entry to a file, or reads a file written with the same bucket count into the cache
+    //load returns false and leaves the cache as it was when the file is missing or does not match
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+};
+
+#endif
@@ -1,115 +1,263 @@
 #include "deck.h"
+#include "aiweights.h"
+#include "decisioncache.h"
+#include "gamerecord.h"
+#include "instrument.h"
+#include "scoretables.h"
 #include <glpk.h>
 #include <map>
-#include <raylib.h>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <cmath>
 #include <cstdint>
 #include <random>
-#include <queue>
 #include <algorithm>
+#include <cassert>
 #include <limits>
+#include <chrono>
 
 using namespace std;
 
 // ------ PLAYER ------------ PLAYER ------------ PLAYER ------------ PLAYER ------------ PLAYER ------------ PLAYER ------
 
+//it is the position of a card in sortHand order, color first and then type
+static int sortKey(const Card& card) {
+    return card.color * 15 + card.type;
+}
+
 //it creates a new player with the AI flag and the player name
-Player::Player(bool ai, const std::string& playerName) : isAI(ai), name(playerName) {}
+Player::Player(bool ai, const std::string& playerName) : isAI(ai), name(playerName), strategyId(-1), handSorted(true) {}
 
 //it checks if the player has any cards that can be played on the top card
 bool Player::canPlay(const Card& topCard) const {
-    //it loops through all the cards in the players hand
-    for (const auto& card : hand) {
-        //it checks if the card matches the top card by color or value
-        if (card.matches(topCard)) {
-            return true;
+    //it checks the hand counts against the mask of cards that match the top card by color or value
+    return handCounts.canPlay(topCard);
+}
+
+//it is the color count of a full 108-card deck
+static const int FULL_DECK_COLORS[5] = { 25, 25, 25, 25, 8 };
+
+//it is the color a card counts as, since a played wild keeps the color that was picked for it
+static int countedColor(const Card& card) {
+    return card.isWild() ? WILDS : card.color;
+}
+
+//it builds the model of a fresh 7 card hand, which is the same every time
+static OpponentModel makeDealtModel() {
+    OpponentModel model(0);
+    model.observeDraw({ WILDS, WILD }, 7);
+    return model;
+}
+
+//it starts every color from the chance of being dealt that many of it in 7 cards from a full deck
+//it copies a model that was worked out once since every new model starts the same
+OpponentModel::OpponentModel() {
+    static const OpponentModel dealt = makeDealtModel();
+    *this = dealt;
+}
+
+//it starts from an empty hand
+OpponentModel::OpponentModel(int) : totalTurnsObserved(0), turnsWithoutPlaying(0), handSize(0) {
+    for (int c = REDS; c <= YELLOWS; c++) {
+        colorsPlayed[c] = 0;
+        colorsAvoided[c] = 0;
+    }
+    setUnseenCards(FULL_DECK_COLORS);
+    for (int c = 0; c < 5; c++) {
+        for (int k = 0; k <= MODEL_MAX_COLOR_CARDS; k++) {
+            colorPosterior[c][k] = k == 0 ? 1.0 : 0.0;
         }
+        refresh(c);
     }
-    return false; //it returns false if no playable cards are found
 }
 
-//it updates the opponent model based on what the opponent played or drew
-void Player::updateOpponentModel(const Card& playedCard, bool opponentDrew) {
-    opponentModel.totalTurnsObserved++;
+void OpponentModel::setUnseenCards(const int unseenColorCounts[5]) {
+    int total = 0;
+    for (int c = 0; c < 5; c++) total += max(0, unseenColorCounts[c]);
+    for (int c = 0; c < 5; c++) {
+        drawShares[c] = total > 0 ? max(0, unseenColorCounts[c]) / (double)total : FULL_DECK_COLORS[c] / 108.0;
+    }
+}
 
-    if (opponentDrew) {
-        //it increments turns without playing
-        opponentModel.turnsWithoutPlaying++;
+void OpponentModel::refresh(int color) {
+    probabilityHasColor[color] = 1.0 - colorPosterior[color][0];
+    double mean = 0.0;
+    for (int k = 1; k <= MODEL_MAX_COLOR_CARDS; k++) mean += k * colorPosterior[color][k];
+    expectedColorCount[color] = mean;
+}
 
-        //it assumes they avoided all colors if they drew
-        for (int c = REDS; c <= YELLOWS; c++) {
-            opponentModel.colorsAvoided[static_cast<cardColor>(c)]++;
+//it moves the chances of the played color down by one card, keeping only the counts that had that card
+void OpponentModel::observePlay(const Card& card) {
+    handSize = max(0, handSize - 1);
+    int color = countedColor(card);
+    float* posterior = colorPosterior[color];
+
+    double total = 0.0;
+    for (int k = 1; k <= MODEL_MAX_COLOR_CARDS; k++) total += posterior[k];
+    if (total <= 0.0) {
+        //it was sure they had none, so it starts that color over with one card fewer than it could know about
+        for (int k = 0; k <= MODEL_MAX_COLOR_CARDS; k++) posterior[k] = k == 0 ? 1.0 : 0.0;
+    }
+    else {
+        for (int k = 1; k <= MODEL_MAX_COLOR_CARDS; k++) posterior[k - 1] = posterior[k] / total;
+        posterior[MODEL_MAX_COLOR_CARDS] = 0.0;
+    }
+    refresh(color);
+}
+
+//it is how likely an opponent that holds the top color still draws, for humans and strategies that hold cards back
+const double DRAW_WHILE_HOLDING_COLOR = 0.05;
+
+void OpponentModel::observeDraw(const Card& topCard, int cardsDrawn) {
+    //it makes holding the top color unlikely after a draw that was not forced by a draw stack
+    if (cardsDrawn == 1 && topCard.color != WILDS) {
+        float* posterior = colorPosterior[topCard.color];
+        double total = posterior[0];
+        for (int k = 1; k <= MODEL_MAX_COLOR_CARDS; k++) {
+            posterior[k] *= DRAW_WHILE_HOLDING_COLOR;
+            total += posterior[k];
         }
-    } else {
-        //it resets the counter since they played
-        opponentModel.turnsWithoutPlaying = 0;
+        for (int k = 0; k <= MODEL_MAX_COLOR_CARDS; k++) posterior[k] /= total;
+    }
 
-        //it records the color they played
-        if (playedCard.color != WILDS) {
-            opponentModel.colorsPlayed[playedCard.color]++;
+    //it adds each drawn card to every color with the chance that it has that color
+    for (int c = 0; c < 5; c++) {
+        float* posterior = colorPosterior[c];
+        double share = drawShares[c];
+        for (int d = 0; d < cardsDrawn; d++) {
+            posterior[MODEL_MAX_COLOR_CARDS] += posterior[MODEL_MAX_COLOR_CARDS - 1] * share;
+            for (int k = MODEL_MAX_COLOR_CARDS - 1; k > 0; k--) {
+                posterior[k] = posterior[k] * (1.0 - share) + posterior[k - 1] * share;
+            }
+            posterior[0] *= 1.0 - share;
         }
+        refresh(c);
     }
+    handSize += cardsDrawn;
 }
 
-//it calculates the utility value of a card based on the game state for the AI to use
-double LPOptimizer::getCardUtility(const Card& card, int handSize, int opponentHandSize) {
-    double utility = 0.0;
+//it starts every seat from the deal, and leaves the seats past numSeats alone since they are never read
+void TableModel::reset(int seatCount, int ownerSeat) {
+    numSeats = max(1, min(seatCount, MAX_SEATS));
+    owner = ownerSeat;
+    nextSeat = numSeats > 1 ? (ownerSeat + 1) % numSeats : ownerSeat;
+    for (int s = 0; s < numSeats; s++) {
+        seats[s] = OpponentModel();
+        handSizes[s] = 7;
+        refresh(s);
+    }
+}
 
-    //it assigns base utility values to each card type for the AI to know which cards are better
-    switch (card.type) {
-        case WILD_DRAW_FOUR:
-            utility = 10.0; //it is the most powerful card so it gets the highest value
-            break;
-        case WILD:
-            utility = 8.0; //it is very useful for changing colors
-            break;
-        case DRAW_TWO:
-            utility = 7.0; //it is a strong offensive card
-            break;
-        case SKIP:
-            utility = 6.0; //it is a tactical card that skips the opponent
-            break;
-        case REVERSE:
-            utility = 6.0; //it is a tactical card that changes direction
-            break;
-        default: //it is for the number cards 0-9
-            //it gets the utility based on the cards value so higher numbers are slightly better
-            utility = 2.0 + card.type;
-            break;
+void TableModel::refresh(int seat) {
+    turnsWithoutPlaying[seat] = seats[seat].turnsWithoutPlaying;
+    for (int c = 0; c < 5; c++) {
+        probabilityHasColor[c][seat] = seats[seat].getProbabilityHasColor(static_cast<cardColor>(c));
     }
+}
 
-    //it adjusts the utility when the AI is close to winning with 2 or fewer cards
-    if (handSize <= 2) {
-        utility += 5.0; //it boosts all cards because the AI just wants to get rid of cards
+void TableModel::observePlay(int seat, const Card& card, int newHandSize) {
+    if (seat < 0 || seat >= numSeats) return;
+    OpponentModel& model = seats[seat];
+    model.totalTurnsObserved++;
+    model.turnsWithoutPlaying = 0;
+    if (!card.isWild()) {
+        model.colorsPlayed[card.color]++;
     }
+    model.observePlay(card);
+    handSizes[seat] = newHandSize;
+    refresh(seat);
+}
 
-    //it adjusts the utility when the opponent is close to winning with 2 or fewer cards
-    if (opponentHandSize <= 2) {
-        //it prioritizes cards that can disrupt the opponent from winning
-        if (card.type == DRAW_TWO || card.type == WILD_DRAW_FOUR ||
-            card.type == SKIP) {
-            utility += 8.0; //it gives a significant boost to defensive cards
+void TableModel::observeDraw(int seat, const Card& topCard, int cardsDrawn, const int* unseenColorCounts, int newHandSize) {
+    if (seat < 0 || seat >= numSeats) return;
+    OpponentModel& model = seats[seat];
+    model.totalTurnsObserved++;
+    model.turnsWithoutPlaying++;
+
+    //it counts the top color as avoided since they could not play on it
+    if (cardsDrawn == 1 && topCard.color != WILDS) {
+        model.colorsAvoided[topCard.color]++;
+    }
+    if (unseenColorCounts) {
+        model.setUnseenCards(unseenColorCounts);
+    }
+    model.observeDraw(topCard, cardsDrawn);
+    handSizes[seat] = newHandSize;
+    refresh(seat);
+}
+
+//it finds the seat after every kind of card in both directions and copies its color chances
+//the current direction is the one that leads from the owner to nextSeat
+SeatView SeatView::of(const TableModel& table, int nextHandSize) {
+    int n = table.numSeats;
+    int step = (table.nextSeat - table.owner + n) % n;
+    auto along = [&](int direction, int seats) {
+        return (table.owner + (direction == 0 ? step : n - step) * seats) % n;
+    };
+
+    SeatView view;
+    for (int d = 0; d < 2; d++) {
+        view.hitHandSize[d] = d == 0 ? nextHandSize : table.handSizes[along(d, 1)];
+        int answering[HANDOFF_KINDS] = { along(d, 1), along(d, 2), along(1 - d, 1) };
+        if (n == 2) answering[HANDOFF_REVERSE] = table.owner; //it is a skip with two seats
+        for (int k = 0; k < HANDOFF_KINDS; k++) {
+            for (int c = REDS; c <= YELLOWS; c++) {
+                view.answerHasColor[d][k][c] = answering[k] == table.owner ? 0.0 : table.probabilityHasColor[c][answering[k]];
+            }
         }
     }
+    return view;
+}
 
-    //it makes wild cards more valuable when the AI has many cards because they provide flexibility
-    if (card.isWild() && handSize > 5) {
-        utility += 3.0; //it tells the AI to hold onto wilds when it has options
+SeatView SeatView::headsUp(int opponentHandSize, const OpponentModel& opponentModel) {
+    SeatView view;
+    for (int d = 0; d < 2; d++) {
+        view.hitHandSize[d] = opponentHandSize;
+        for (int c = REDS; c <= YELLOWS; c++) {
+            view.answerHasColor[d][HANDOFF_NEXT][c] = opponentModel.getProbabilityHasColor(static_cast<cardColor>(c));
+            view.answerHasColor[d][HANDOFF_SKIP][c] = 0.0;
+            view.answerHasColor[d][HANDOFF_REVERSE][c] = 0.0;
+        }
+    }
+    return view;
+}
+
+//it updates the model of a seat based on what that seat played or drew
+void Player::updateOpponentModel(int seat, const Card& playedCard, bool opponentDrew, int newHandSize,
+                                 int cardsDrawn, const int* unseenColorCounts) {
+    if (!opponentDrew) {
+        tableModel.observePlay(seat, playedCard, newHandSize);
+        return;
+    }
+
+    //the cards they draw come from the ones this player can not see, which leaves out its own hand
+    if (unseenColorCounts) {
+        int unseen[5];
+        for (int c = 0; c < 5; c++) {
+            unseen[c] = unseenColorCounts[c] - handCounts.colorCounts[c];
+        }
+        tableModel.observeDraw(seat, playedCard, cardsDrawn, unseen, newHandSize);
+    }
+    else {
+        tableModel.observeDraw(seat, playedCard, cardsDrawn, nullptr, newHandSize);
     }
+}
 
-    return utility;
+//it calculates the utility value of a card based on the game state for the AI to use
+double LPOptimizer::getCardUtility(const Card& card, int handSize, int opponentHandSize) {
+    //it reads the utility from the table that cardUtilityRule filled from the weights of this thread
+    return AIWeights::active().cardUtility(card.type, handSize, opponentHandSize);
 }
 
 //it calculates how versatile a card is based on how many situations it can be played in
 double LPOptimizer::getCardVersatility(const Card& card, const std::vector<Card>& hand) {
+    const AIWeights& weights = AIWeights::active();
     double versatility = 0.0;
 
     //it makes wild cards extremely versatile since they can always be played
     if (card.isWild()) {
-        return 10.0;
+        return weights[WEIGHT_VERSATILITY_WILD];
     }
 
     //it counts how many other cards in hand share this cards color
@@ -126,11 +274,28 @@ double LPOptimizer::getCardVersatility(const Card& card, const std::vector<Card>
     }
 
     //it gives higher versatility to cards that connect well with the hand
-    versatility = 2.0 + sameColorCount * 0.5 + sameValueCount * 0.3;
+    versatility = weights[WEIGHT_VERSATILITY_BASE] + sameColorCount * weights[WEIGHT_VERSATILITY_COLOR]
+        + sameValueCount * weights[WEIGHT_VERSATILITY_TYPE];
 
     return versatility;
 }
 
+//it calculates the same versatility as above but reads the color and type counts instead of scanning the hand
+double LPOptimizer::getCardVersatility(const Card& card, const HandCounts& counts) {
+    const AIWeights& weights = AIWeights::active();
+
+    //it makes wild cards extremely versatile since they can always be played
+    if (card.isWild()) {
+        return weights[WEIGHT_VERSATILITY_WILD];
+    }
+
+    int sameColorCount = card.color != WILDS ? counts.colorCounts[card.color] : 0;
+    int sameValueCount = counts.typeCounts[card.type];
+
+    return weights[WEIGHT_VERSATILITY_BASE] + sameColorCount * weights[WEIGHT_VERSATILITY_COLOR]
+        + sameValueCount * weights[WEIGHT_VERSATILITY_TYPE];
+}
+
 //it calculates the probability that the opponent can block this play
 double LPOptimizer::getBlockingProbability(const Card& cardToPlay, const OpponentModel& model) {
     //it estimates how likely opponent has a matching card
@@ -139,30 +304,32 @@ double LPOptimizer::getBlockingProbability(const Card& cardToPlay, const Opponen
         return 0.0; //it cant be blocked since wild changes color
     }
 
-    //it gets the probability opponent has this color
-    double colorProb = model.getProbabilityHasColor(cardToPlay.color);
-
-    //it adjusts based on how many turns they havent played
-    if (model.turnsWithoutPlaying > 2) {
-        colorProb *= 0.5; //it reduces probability if theyve been drawing
-    }
-
-    return colorProb;
+    //it gets the probability opponent has this color from the posterior, which already counts their draws
+    return model.getProbabilityHasColor(cardToPlay.color);
 }
 
 //it evaluates a sequence of cards to see how good it would be to play them in order
 double LPOptimizer::evaluateSequence(const std::vector<Card>& hand,
                                       const std::vector<int>& sequence,
-                                      const Card& topCard, int opponentHandSize,
-                                      const OpponentModel& opponentModel) {
-    if (sequence.empty()) return -1000.0;
+                                      const Card& topCard, const SeatView& seats) {
+    return evaluateSequence(hand, HandCounts(hand), sequence.data(), sequence.size(), topCard, seats);
+}
 
+//it evaluates a sequence with hand counts that the caller built once for the whole search
+double LPOptimizer::evaluateSequence(const std::vector<Card>& hand, const HandCounts& counts,
+                                      const int* sequence, int length,
+                                      const Card& topCard, const SeatView& seats) {
+    UNO_TIME_SCOPE(PROBE_EVALUATE_SEQUENCE);
+    if (length == 0) return -1000.0;
+
+    const AIWeights& weights = AIWeights::active();
     double totalUtility = 0.0;
     Card currentTop = topCard;
     int remainingHandSize = hand.size();
+    int direction = 0; //it flips with every reverse in the sequence
 
     //it simulates playing each card in the sequence
-    for (size_t i = 0; i < sequence.size(); i++) {
+    for (int i = 0; i < length; i++) {
         int cardIdx = sequence[i];
         const Card& card = hand[cardIdx];
 
@@ -171,20 +338,20 @@ double LPOptimizer::evaluateSequence(const std::vector<Card>& hand,
             return -1000.0; //it penalizes invalid sequences heavily
         }
 
-        //it gets the base utility of playing this card
-        double cardUtil = getCardUtility(card, remainingHandSize, opponentHandSize);
+        //it gets the base utility of playing this card against the hand of the seat it hits
+        double cardUtil = weights.cardUtility(card.type, remainingHandSize, seats.hitHandSize[direction]);
 
         //it adds versatility bonus for early cards in sequence
-        double versatility = getCardVersatility(card, hand);
+        double versatility = getCardVersatility(card, counts);
         double versatilityBonus = versatility * (1.0 / (i + 1)); //it decreases over turns
 
-        //it calculates blocking probability
-        double blockProb = getBlockingProbability(card, opponentModel);
-        double blockPenalty = blockProb * 2.0; //it penalizes cards that might get blocked
+        //it calculates the chance that the seat the card hands the turn to can block it
+        double blockProb = seats.blockingProbability(card, direction);
+        double blockPenalty = blockProb * weights[WEIGHT_BLOCK_PENALTY]; //it penalizes cards that might get blocked
 
         //it adds point value consideration - play high value cards early
         double pointValue = card.getPointValue();
-        double pointBonus = pointValue * 0.1 * (sequence.size() - i); //it rewards playing high cards first
+        double pointBonus = pointValue * weights[WEIGHT_POINT_BONUS] * (length - i); //it rewards playing high cards first
 
         //it combines all factors
         totalUtility += cardUtil + versatilityBonus - blockPenalty + pointBonus;
@@ -192,119 +359,393 @@ double LPOptimizer::evaluateSequence(const std::vector<Card>& hand,
         //it updates state for next iteration
         currentTop = card;
         remainingHandSize--;
+        direction = SeatView::directionAfter(card.type, direction);
     }
 
     //it adds bonus for reducing hand size
-    totalUtility += (sequence.size() * 5.0);
+    totalUtility += (length * weights[WEIGHT_LENGTH_BONUS]);
 
     return totalUtility;
 }
 
-//it creates a plan for the next N turns using multi-turn planning
-TurnPlan LPOptimizer::planNextTurns(const std::vector<Card>& hand, const Card& topCard,
-                                     int opponentHandSize, const OpponentModel& opponentModel,
-                                     int numTurns) {
-    TurnPlan bestPlan;
-    bestPlan.expectedUtility = -std::numeric_limits<double>::infinity();
+//it is the hash keys: the hand key is the sum of slotKeys over every held card so it updates in O(1)
+struct PlanHashKeys {
+    uint64_t slotKeys[HAND_SLOTS];
+    uint64_t topKeys[HAND_SLOTS];
 
-    //it finds all playable cards for the first turn
-    std::vector<int> playableIndices;
-    for (int i = 0; i < hand.size(); i++) {
-        if (hand[i].matches(topCard)) {
-            playableIndices.push_back(i);
+    PlanHashKeys() {
+        uint64_t state = 0x5EED0F0CA2D5ULL;
+        for (int s = 0; s < HAND_SLOTS; s++) slotKeys[s] = splitMix64(state);
+        for (int s = 0; s < HAND_SLOTS; s++) topKeys[s] = splitMix64(state);
+    }
+};
+static const PlanHashKeys planHashKeys;
+
+//it is one entry of the transposition table of the sequence search
+struct PlanTableEntry {
+    uint64_t key;         //it is the (remaining hand, top card) key
+    uint32_t generation;  //it is the search that wrote the entry so old entries never need clearing
+    int bestSlot;         //it is the slot to play next or -1 to stop
+    double value;         //it is the best utility still to gain from this position
+};
+
+const int PLAN_TABLE_SIZE = 1 << 15;
+
+//it is the depth-N search over card chains behind planNextTurns
+//the utility of a sequence is split into one gain per card so prefixes are scored incrementally:
+//  evaluateSequence gives card i pointValue * pointBonus * (length - i), which is the same as giving the card at
+//  position j pointBonus * (points of cards 0..j), so each step only needs the points played so far
+//each card is scored against the seat it hands the turn to in the direction of play at that point, which is
+//turned around by every reverse already played, so it also follows from the remaining hand
+//the best continuation then only depends on the remaining hand and the top card, which is the table key
+struct SequenceSearch {
+    const AIWeights& weights;
+    const SeatView& seats;
+    HandCounts remaining;
+    uint64_t handKey;
+    int handSize;
+    int reversesInHand;
+    int maxDepth;
+    double versatility[HAND_SLOTS];
+    double blockPenalty[2][HAND_SLOTS];  //it is the block penalty of each card in each direction
+    int points[HAND_SLOTS];
+    double maxUtility;
+    double maxVersatility;
+    double minBlockPenalty;
+    int maxPoints;
+    PlanTableEntry* table;
+    uint32_t generation;
+
+    //it is the budget of an anytime search, where a node limit of 0 and no deadline never stop the search
+    long long nodes;
+    long long nodeLimit;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+    bool aborted;
+
+    SequenceSearch(const std::vector<Card>& hand, const SeatView& seatView, int depth)
+        : weights(AIWeights::active()), seats(seatView), remaining(hand), handKey(0), handSize(hand.size()),
+          reversesInHand(remaining.typeCounts[REVERSE]), maxDepth(depth),
+          maxUtility(0.0), maxVersatility(0.0), minBlockPenalty(std::numeric_limits<double>::infinity()),
+          maxPoints(0), nodes(0), nodeLimit(0), hasDeadline(false), aborted(false) {
+        //it scores every distinct card once instead of once per sequence
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            if (remaining.counts[s] == 0) continue;
+            Card card = HandCounts::cardOf(s);
+            versatility[s] = LPOptimizer::getCardVersatility(card, remaining);
+            points[s] = card.getPointValue();
+            handKey += planHashKeys.slotKeys[s] * remaining.counts[s];
+
+            //it bounds the utility over every hand size and both directions by taking the best of every bucket
+            for (int d = 0; d < 2; d++) {
+                blockPenalty[d][s] = seats.blockingProbability(card, d) * weights[WEIGHT_BLOCK_PENALTY];
+                minBlockPenalty = min(minBlockPenalty, blockPenalty[d][s]);
+                for (int bucketHand : UTILITY_BUCKET_HAND) {
+                    maxUtility = max(maxUtility, weights.cardUtility(card.type, bucketHand, seats.hitHandSize[d]));
+                }
+            }
+            maxVersatility = max(maxVersatility, versatility[s]);
+            maxPoints = max(maxPoints, points[s]);
         }
+
+        //it reuses one table per thread and invalidates the old entries by moving to a new generation
+        static thread_local std::vector<PlanTableEntry> sharedTable(PLAN_TABLE_SIZE, PlanTableEntry{0, 0, -1, 0.0});
+        static thread_local uint32_t sharedGeneration = 0;
+        if (++sharedGeneration == 0) {
+            std::fill(sharedTable.begin(), sharedTable.end(), PlanTableEntry{0, 0, -1, 0.0});
+            sharedGeneration = 1;
+        }
+        table = sharedTable.data();
+        generation = sharedGeneration;
     }
 
-    if (playableIndices.empty()) {
-        bestPlan.expectedHandSize = hand.size() + 1; //it will draw a card
-        return bestPlan;
+    //it is the direction of play before the next card, from how many reverses left the hand
+    int direction() const {
+        return (reversesInHand - remaining.typeCounts[REVERSE]) & 1;
     }
 
-    //it limits turns to plan based on hand size
-    numTurns = min(numTurns, (int)hand.size());
-    numTurns = min(numTurns, 3); //it caps at 3 turns to keep it fast
-
-    //it tries different sequences of cards
-    if (numTurns == 1) {
-        //it just picks the best single card
-        for (int idx : playableIndices) {
-            std::vector<int> seq = {idx};
-            double utility = evaluateSequence(hand, seq, topCard, opponentHandSize, opponentModel);
-
-            if (utility > bestPlan.expectedUtility) {
-                bestPlan.cardSequence = seq;
-                bestPlan.expectedUtility = utility;
-                bestPlan.expectedHandSize = hand.size() - 1;
+    //it is the utility of playing the card in this slot at this position
+    double stepGain(int slot, int position, int pointsAfter) const {
+        Card card = HandCounts::cardOf(slot);
+        int d = direction();
+        return weights.cardUtility(card.type, handSize - position, seats.hitHandSize[d])
+            + versatility[slot] / (position + 1)
+            - blockPenalty[d][slot]
+            + weights[WEIGHT_POINT_BONUS] * pointsAfter
+            + weights[WEIGHT_LENGTH_BONUS];
+    }
+
+    //it is an upper bound on what can still be gained after a card is played at position-1
+    double optimisticFuture(int position, int pointsAfter) const {
+        int steps = min(maxDepth - position, remaining.total - 1);
+        if (steps <= 0) return 0.0;
+        //a chain gains at most the sum of its steps that gain, so each step is bounded on its own and never below 0,
+        //which keeps the bound when weights are negative, and the points still to be played only add to a positive point bonus
+        double pointBonus = weights[WEIGHT_POINT_BONUS];
+        double stepBound = maxUtility + maxVersatility / (position + 1) - minBlockPenalty
+            + weights[WEIGHT_LENGTH_BONUS] + pointBonus * pointsAfter;
+        double future = 0.0;
+        for (int step = 1; step <= steps; step++) {
+            future += max(0.0, stepBound + max(0.0, pointBonus) * maxPoints * step);
+        }
+        return future;
+    }
+
+    //it lists the moves in the mask sorted by their step gain from highest to lowest
+    int orderMoves(uint64_t moves, int position, int pointsSoFar, int* slots, double* gains) const {
+        int count = 0;
+        while (moves) {
+            int slot = std::countr_zero(moves);
+            moves &= moves - 1;
+            double gain = stepGain(slot, position, pointsSoFar + points[slot]);
+
+            //it inserts the move in order since there are only a handful of distinct playable cards
+            int i = count++;
+            while (i > 0 && gains[i - 1] < gain) {
+                slots[i] = slots[i - 1];
+                gains[i] = gains[i - 1];
+                i--;
             }
+            slots[i] = slot;
+            gains[i] = gain;
         }
-    } else if (numTurns == 2) {
-        //it tries all pairs of cards
-        for (int idx1 : playableIndices) {
-            Card firstCard = hand[idx1];
+        return count;
+    }
 
-            //it finds cards that could be played after the first card
-            for (int idx2 = 0; idx2 < hand.size(); idx2++) {
-                if (idx2 == idx1) continue;
+    //it counts a node and checks the budget, reading the clock only every 64 nodes since that is slower than a node
+    bool outOfBudget() {
+        nodes++;
+        if (nodeLimit > 0 && nodes > nodeLimit) {
+            aborted = true;
+        }
+        else if (hasDeadline && (nodes & 63) == 0 && std::chrono::steady_clock::now() >= deadline) {
+            aborted = true;
+        }
+        return aborted;
+    }
 
-                if (hand[idx2].matches(firstCard)) {
-                    std::vector<int> seq = {idx1, idx2};
-                    double utility = evaluateSequence(hand, seq, topCard, opponentHandSize, opponentModel);
+    //it finds the entry of a position in the table
+    PlanTableEntry& entryFor(uint64_t key) {
+        return table[key & (PLAN_TABLE_SIZE - 1)];
+    }
 
-                    if (utility > bestPlan.expectedUtility) {
-                        bestPlan.cardSequence = seq;
-                        bestPlan.expectedUtility = utility;
-                        bestPlan.expectedHandSize = hand.size() - 2;
-                    }
-                }
+    //it returns the best utility still to gain after the card in topSlot was played at position-1
+    double search(int topSlot, int position, int pointsSoFar) {
+        if (position >= maxDepth || aborted || outOfBudget()) return 0.0;
+
+        uint64_t key = handKey + planHashKeys.topKeys[topSlot];
+        PlanTableEntry& cached = entryFor(key);
+        if (cached.generation == generation && cached.key == key) {
+            UNO_COUNT(COUNTER_PLAN_TABLE_HITS, 1);
+            return cached.value;
+        }
+
+        double best = 0.0; //it can always stop here
+        int bestSlot = -1;
+
+        //it tries the cards with the biggest gain first so the bound prunes more of the rest
+        int moveSlots[HAND_SLOTS];
+        double moveGains[HAND_SLOTS];
+        int numMoves = orderMoves(remaining.playable(HandCounts::cardOf(topSlot)), position, pointsSoFar,
+                                  moveSlots, moveGains);
+        for (int m = 0; m < numMoves; m++) {
+            int slot = moveSlots[m];
+            int pointsAfter = pointsSoFar + points[slot];
+            double gain = moveGains[m];
+
+            //it skips the card when even the best possible chain after it cannot beat the best so far
+            if (gain + optimisticFuture(position + 1, pointsAfter) <= best) {
+                UNO_COUNT(COUNTER_PLAN_PRUNED, 1);
+                continue;
             }
 
-            //it also considers just playing the first card
-            std::vector<int> seq = {idx1};
-            double utility = evaluateSequence(hand, seq, topCard, opponentHandSize, opponentModel);
+            Card card = HandCounts::cardOf(slot);
+            remaining.remove(card);
+            handKey -= planHashKeys.slotKeys[slot];
+            double value = gain + search(slot, position + 1, pointsAfter);
+            remaining.add(card);
+            handKey += planHashKeys.slotKeys[slot];
 
-            if (utility > bestPlan.expectedUtility) {
-                bestPlan.cardSequence = seq;
-                bestPlan.expectedUtility = utility;
-                bestPlan.expectedHandSize = hand.size() - 1;
+            if (value > best) {
+                best = value;
+                bestSlot = slot;
             }
         }
-    } else {
-        //it tries triple sequences for 3 turns
-        for (int idx1 : playableIndices) {
-            Card firstCard = hand[idx1];
 
-            for (int idx2 = 0; idx2 < hand.size(); idx2++) {
-                if (idx2 == idx1) continue;
-                if (!hand[idx2].matches(firstCard)) continue;
+        //it does not keep a value that was cut short by the budget
+        if (aborted) return best;
 
-                Card secondCard = hand[idx2];
+        PlanTableEntry& entry = entryFor(key);
+        entry = PlanTableEntry{key, generation, bestSlot, best};
+        return best;
+    }
 
-                for (int idx3 = 0; idx3 < hand.size(); idx3++) {
-                    if (idx3 == idx1 || idx3 == idx2) continue;
-                    if (!hand[idx3].matches(secondCard)) continue;
+    //it gets the best slot to play after topSlot, searching again if the entry was overwritten
+    int bestNextSlot(int topSlot, int position, int pointsSoFar) {
+        search(topSlot, position, pointsSoFar);
+        if (position >= maxDepth) return -1;
+        return entryFor(handKey + planHashKeys.topKeys[topSlot]).bestSlot;
+    }
+};
 
-                    std::vector<int> seq = {idx1, idx2, idx3};
-                    double utility = evaluateSequence(hand, seq, topCard, opponentHandSize, opponentModel);
+//it runs the search from the root and fills in the plan, trying firstSlot first when it is playable
+//it returns false without a plan if the budget ran out before every first card was searched
+static bool runPlanSearch(SequenceSearch& searcher, const std::vector<Card>& hand, const Card& topCard,
+                          int firstSlot, TurnPlan& bestPlan) {
+    bestPlan.cardSequence.length = 0;
+    bestPlan.expectedUtility = -std::numeric_limits<double>::infinity();
 
-                    if (utility > bestPlan.expectedUtility) {
-                        bestPlan.cardSequence = seq;
-                        bestPlan.expectedUtility = utility;
-                        bestPlan.expectedHandSize = hand.size() - 3;
-                    }
-                }
+    uint64_t firstMoves = searcher.remaining.playable(topCard);
+    if (firstMoves == 0 || searcher.maxDepth <= 0) {
+        bestPlan.expectedHandSize = hand.size() + 1; //it will draw a card
+        return true;
+    }
+
+    //it tries every distinct playable card first since identical cards lead to the same plans
+    int bestSlot = -1;
+    int moveSlots[HAND_SLOTS];
+    double moveGains[HAND_SLOTS];
+    int numMoves = searcher.orderMoves(firstMoves, 0, 0, moveSlots, moveGains);
+    for (int m = 1; m < numMoves; m++) {
+        if (moveSlots[m] == firstSlot) {
+            std::rotate(moveSlots, moveSlots + m, moveSlots + m + 1);
+            std::rotate(moveGains, moveGains + m, moveGains + m + 1);
+            break;
+        }
+    }
+    for (int m = 0; m < numMoves; m++) {
+        int slot = moveSlots[m];
+        int pointsAfter = searcher.points[slot];
+        double gain = moveGains[m];
+        if (gain + searcher.optimisticFuture(1, pointsAfter) <= bestPlan.expectedUtility) {
+            UNO_COUNT(COUNTER_PLAN_PRUNED, 1);
+            continue;
+        }
+
+        Card card = HandCounts::cardOf(slot);
+        searcher.remaining.remove(card);
+        searcher.handKey -= planHashKeys.slotKeys[slot];
+        double value = gain + searcher.search(slot, 1, pointsAfter);
+        searcher.remaining.add(card);
+        searcher.handKey += planHashKeys.slotKeys[slot];
+        if (searcher.aborted) return false;
+
+        if (value > bestPlan.expectedUtility) {
+            bestPlan.expectedUtility = value;
+            bestSlot = slot;
+        }
+    }
+
+    //it follows the best moves stored in the table to rebuild the sequence of slots
+    //it lifts the budget first since a plan that was fully searched must always be rebuilt
+    searcher.nodeLimit = 0;
+    searcher.hasDeadline = false;
+    PlanSequence slots;
+    int pointsSoFar = 0;
+    for (int slot = bestSlot, position = 0; slot != -1; position++) {
+        slots.push_back(slot);
+        pointsSoFar += searcher.points[slot];
+        searcher.remaining.remove(HandCounts::cardOf(slot));
+        searcher.handKey -= planHashKeys.slotKeys[slot];
+        slot = searcher.bestNextSlot(slot, position + 1, pointsSoFar);
+    }
+
+    //it turns the slots back into hand indices using the first copy of each card not already in the plan
+    for (int slot : slots) {
+        for (int i = 0; i < (int)hand.size(); i++) {
+            if (HandCounts::slotOf(hand[i]) != slot) continue;
+            bool used = false;
+            for (int chosen : bestPlan.cardSequence) {
+                used = used || chosen == i;
+            }
+            if (!used) {
+                bestPlan.cardSequence.push_back(i);
+                break;
             }
         }
     }
+    bestPlan.expectedHandSize = hand.size() - bestPlan.cardSequence.size();
+    return true;
+}
 
+//it creates a plan for the next N turns using a depth-N search over card chains
+TurnPlan LPOptimizer::planNextTurns(const std::vector<Card>& hand, const Card& topCard,
+                                     const SeatView& seats, int numTurns) {
+    //it limits turns to plan based on hand size
+    numTurns = min(numTurns, (int)hand.size());
+    numTurns = min(numTurns, MAX_PLAN_DEPTH);
+
+    UNO_TIME_SCOPE(PROBE_PLAN_NEXT_TURNS);
+    TurnPlan bestPlan;
+    SequenceSearch searcher(hand, seats, numTurns);
+    runPlanSearch(searcher, hand, topCard, -1, bestPlan);
+    UNO_COUNT(COUNTER_PLAN_NODES, searcher.nodes);
     return bestPlan;
 }
 
+//it searches one turn deeper at a time and keeps the plan of the deepest search that finished
+//depth 1 always runs to the end so there is a plan even with no budget at all
+AnytimePlan LPOptimizer::planAnytime(const std::vector<Card>& hand, const Card& topCard,
+                                     const SeatView& seats, const PlanBudget& budget) {
+    UNO_TIME_SCOPE(PROBE_PLAN_ANYTIME);
+    auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double, std::micro>(budget.timeBudgetUs));
+
+    int depthLimit = min({ budget.maxDepth, (int)hand.size(), MAX_PLAN_DEPTH });
+    AnytimePlan result;
+    result.depthReached = 0;
+    result.nodes = 0;
+    result.complete = false;
+    if (depthLimit <= 0) {
+        result.plan = planNextTurns(hand, topCard, seats, 0);
+        result.complete = true;
+        return result;
+    }
+
+    int firstSlot = -1;
+    for (int depth = 1; depth <= depthLimit; depth++) {
+        SequenceSearch searcher(hand, seats, depth);
+        if (depth > 1) {
+            if (budget.nodeBudget > 0) {
+                if (result.nodes >= budget.nodeBudget) break;
+                searcher.nodeLimit = budget.nodeBudget - result.nodes;
+            }
+            if (budget.timeBudgetUs > 0.0) {
+                if (std::chrono::steady_clock::now() >= deadline) break;
+                searcher.hasDeadline = true;
+                searcher.deadline = deadline;
+            }
+        }
+
+        TurnPlan plan;
+        bool finished = runPlanSearch(searcher, hand, topCard, firstSlot, plan);
+        result.nodes += searcher.nodes;
+        UNO_COUNT(COUNTER_PLAN_NODES, searcher.nodes);
+        if (!finished) {
+            UNO_COUNT(COUNTER_PLAN_CUT_SHORT, 1);
+            break;
+        }
+
+        result.plan = plan;
+        result.depthReached = depth;
+
+        //it stops when nothing can be played since every depth would draw
+        if (plan.cardSequence.empty()) {
+            result.complete = true;
+            break;
+        }
+        firstSlot = HandCounts::slotOf(hand[plan.cardSequence[0]]);
+    }
+    result.complete = result.complete || result.depthReached == depthLimit;
+    return result;
+}
+
 //it uses advanced linear programming with multi-turn planning and opponent modeling
 int LPOptimizer::solveLPMultiTurn(const std::vector<Card>& hand, const Card& topCard,
-                                   int handSize, int opponentHandSize,
-                                   const OpponentModel& opponentModel, int turnsAhead) {
+                                   int handSize, const SeatView& seats, int turnsAhead) {
     //it creates a multi-turn plan
-    TurnPlan plan = planNextTurns(hand, topCard, opponentHandSize, opponentModel, turnsAhead);
+    TurnPlan plan = planNextTurns(hand, topCard, seats, turnsAhead);
 
     //it returns the first card in the best sequence
     if (!plan.cardSequence.empty()) {
@@ -314,11 +755,30 @@ int LPOptimizer::solveLPMultiTurn(const std::vector<Card>& hand, const Card& top
     return -1; //it means draw a card
 }
 
+//it makes an empty buffer that already has room for capacity elements
+template <class T>
+static std::vector<T> reservedBuffer(size_t capacity) {
+    std::vector<T> buffer;
+    buffer.reserve(capacity);
+    return buffer;
+}
+
 //it uses linear programming to determine the optimal card to play for the AI
 int LPOptimizer::solveLPForBestCard(const std::vector<Card>& hand, const Card& topCard, int handSize, int opponentHandSize)
 {
-    //it finds all the cards that can legally be played
-    std::vector<int> playableIndices;
+    UNO_TIME_SCOPE(PROBE_SOLVE_LP_BEST_CARD);
+
+    //it returns -1 right away when the hand counts show nothing can be played
+    HandCounts counts(hand);
+    if (!counts.canPlay(topCard)) {
+        return -1;
+    }
+
+    //it finds all the cards that can legally be played into a buffer this thread reuses every move
+    //the buffers start with room for a whole deck so a bigger hand than any before never grows them
+    static thread_local std::vector<int> playableIndices = reservedBuffer<int>(DECK_SIZE);
+    static thread_local std::vector<double> utilities = reservedBuffer<double>(DECK_SIZE);
+    playableIndices.clear();
     for (int i = 0; i < hand.size(); i++) {
         if (hand[i].matches(topCard)) {
             playableIndices.push_back(i);
@@ -335,73 +795,15 @@ int LPOptimizer::solveLPForBestCard(const std::vector<Card>& hand, const Card& t
         return playableIndices[0];
     }
 
-    //it sets up the linear programming problem using GLPK
-    glp_prob *lp;
-    lp = glp_create_prob(); //it creates a new LP problem instance
-    glp_set_prob_name(lp, "UNO_Card_Selection"); //it names the problem for debugging
-    glp_set_obj_dir(lp, GLP_MAX); //it tells the solver to maximize utility
-
-    int numPlayable = playableIndices.size();
-
-    //it creates binary decision variables one for each playable card
-    //each variable x[i] will be either 0 for dont play or 1 for play
-    glp_add_cols(lp, numPlayable);
-
-    for (int i = 0; i < numPlayable; i++) {
-        //it sets up the variable name for debugging purposes
-        char var_name[50];
-        snprintf(var_name, sizeof(var_name), "play_card_%d", i);
-        glp_set_col_name(lp, i + 1, var_name);
-
-        //it makes this a binary variable so it can only be 0 or 1
-        glp_set_col_kind(lp, i + 1, GLP_BV);
-
-        //it sets the objective coefficient which is how much utility this card provides
-        int cardIdx = playableIndices[i];
-        double utility = getCardUtility(hand[cardIdx], handSize, opponentHandSize);
-        glp_set_obj_coef(lp, i + 1, utility);
+    //it scores each playable card which is the objective coefficient of its binary variable
+    utilities.clear();
+    for (int cardIdx : playableIndices) {
+        utilities.push_back(getCardUtility(hand[cardIdx], handSize, opponentHandSize));
     }
 
-    //it adds the constraint that the AI must play exactly one card
-    glp_add_rows(lp, 1); //it creates one constraint row
-    glp_set_row_name(lp, 1, "play_one_card");
-    //it makes the sum equal exactly 1.0 so only one card is played
-    glp_set_row_bnds(lp, 1, GLP_FX, 1.0, 1.0);
-
-    //it sets up the constraint coefficients for the linear program
-    //these arrays are 1-indexed as required by GLPK
-    int *indices = new int[numPlayable + 1];
-    double *values = new double[numPlayable + 1];
-
-    for (int i = 0; i < numPlayable; i++) {
-        indices[i + 1] = i + 1; //it sets the variable index
-        values[i + 1] = 1.0;     //it makes each variable contribute 1 to the sum
-    }
-
-    //it installs the constraint so the sum of all variables equals 1
-    glp_set_mat_row(lp, 1, numPlayable, indices, values);
-
-    //it solves the optimization problem to find the best card
-    glp_term_out(GLP_OFF); //it suppresses solver output messages
-    glp_simplex(lp, NULL); //it first solves as continuous LP
-    glp_intopt(lp, NULL);  //it then solves as integer program with binary values
-
-    //it extracts the solution to find which card was selected
-    int bestCardIndex = -1;
-    for (int i = 0; i < numPlayable; i++) {
-        double value = glp_mip_col_val(lp, i + 1); //it gets the variable value
-        if (value > 0.5) { //it should be exactly 1 but uses 0.5 for safety
-            bestCardIndex = playableIndices[i];
-            break; //it found the selected card
-        }
-    }
-
-    //it cleans up the memory to prevent memory leaks
-    delete[] indices;
-    delete[] values;
-    glp_delete_prob(lp);
-
-    return bestCardIndex;
+    //it solves play-exactly-one-card with the solver context that this thread keeps between moves
+    int picked = LPSolverContext::forThisThread().solvePickOne(utilities);
+    return picked == -1 ? -1 : playableIndices[picked];
 }
 
 //it lets the AI choose the best card to play using strategic evaluation
@@ -411,16 +813,8 @@ int Player::chooseOptimalCard(const Card& topCard, int opponentHandSize) {
         return -1;
     }
 
-    //it finds all the cards that can legally be played
-    vector<int> playableIndices;
-    for (int i = 0; i < hand.size(); i++) {
-        if (hand[i].matches(topCard)) {
-            playableIndices.push_back(i);
-        }
-    }
-
-    //it returns -1 if there are no playable cards
-    if (playableIndices.empty()) {
+    //it returns -1 right away when the hand counts show nothing can be played
+    if (!handCounts.canPlay(topCard)) {
         return -1;
     }
 
@@ -428,7 +822,12 @@ int Player::chooseOptimalCard(const Card& topCard, int opponentHandSize) {
     int bestIndex = -1;
     double bestScore = -1.0;
 
-    for (int idx : playableIndices) {
+    for (int idx = 0; idx < hand.size(); idx++) {
+        //it skips the cards that can not legally be played
+        if (!hand[idx].matches(topCard)) {
+            continue;
+        }
+
         //it calculates the strategic value of this card
         CardScore score = LPOptimizer::calcCard(hand[idx], topCard,
             hand.size(), opponentHandSize);
@@ -460,21 +859,99 @@ int Player::chooseOptimalCardAdvanced(const Card& topCard, int opponentHandSize,
         return -1;
     }
 
+    //it scores every card against the seat it hands the turn to
+    SeatView seats = SeatView::of(tableModel, opponentHandSize);
+
+    //it plays the move remembered for this position when the decision cache is on
+    //the cache only holds moves of the default weights, so a thread playing with tuned weights plans every move
+    DecisionCache& cache = DecisionCache::instance();
+    if (!cache.isEnabled() || !AIWeights::usingDefaults()) {
+        return LPOptimizer::solveLPMultiTurn(hand, topCard, hand.size(), seats, turnsAhead);
+    }
+
+    DecisionKey key = cache.keyOf(handCounts, topCard, seats, turnsAhead);
+    int slot;
+    if (cache.lookup(key.key, slot)) {
+        if (slot == -1) return -1;
+        slot = key.actualSlot(slot);
+
+        //it only trusts a slot it can play, so two positions sharing a 64-bit key can never make a bad move
+        if ((handCounts.playable(topCard) >> slot) & 1) {
+            for (int i = 0; i < (int)hand.size(); i++) {
+                if (HandCounts::slotOf(hand[i]) == slot) return i;
+            }
+        }
+    }
+
     //it uses the advanced multi-turn LP solver with opponent modeling
-    return LPOptimizer::solveLPMultiTurn(hand, topCard, hand.size(),
-                                          opponentHandSize, opponentModel, turnsAhead);
+    int choice = LPOptimizer::solveLPMultiTurn(hand, topCard, hand.size(), seats, turnsAhead);
+    cache.insert(key.key, choice == -1 ? -1 : key.canonicalSlot(HandCounts::slotOf(hand[choice])));
+    return choice;
+}
+
+//it uses the sequence planner deepened until the budget runs out
+int Player::chooseOptimalCardAnytime(const Card& topCard, int opponentHandSize, const PlanBudget& budget) const {
+    //it only works for AI players
+    if (!isAI) {
+        return -1;
+    }
+
+    AnytimePlan result = LPOptimizer::planAnytime(hand, topCard, SeatView::of(tableModel, opponentHandSize), budget);
+    if (!result.plan.cardSequence.empty()) {
+        return result.plan.cardSequence[0];
+    }
+    return -1; //it means draw a card
+}
+
+//it uses the multi-turn MIP planner that is warm-started from this seat's last plan on this thread
+int Player::chooseOptimalCardMIP(const Card& topCard, int opponentHandSize, int turnsAhead, double timeBudgetUs) const {
+    //it only works for AI players
+    if (!isAI) {
+        return -1;
+    }
+
+    MIPPlanner& planner = MIPPlanner::forThisThread();
+    planner.timeBudgetUs = timeBudgetUs;
+    TurnPlan plan = planner.plan(hand, topCard, SeatView::of(tableModel, opponentHandSize), turnsAhead, tableModel.owner);
+
+    //it returns the first card in the plan
+    if (!plan.cardSequence.empty()) {
+        return plan.cardSequence[0];
+    }
+    return -1; //it means draw a card
 }
 
 //it removes and returns a card from the players hand
 Card Player::playCard(int index) {
     Card played = hand[index];
     hand.erase(hand.begin() + index); //it removes the card from the hand
+    handCounts.remove(played);
     return played;
 }
 
 //it adds a card to the players hand when they draw
 void Player::addCard(const Card& card) {
-    hand.push_back(card);
+    handCounts.add(card);
+
+    //it puts the card after every card that sorts before or with it so the hand stays sorted without a full sort
+    if (handSorted) {
+        int key = sortKey(card);
+        auto position = hand.end();
+        while (position != hand.begin() && sortKey(*(position - 1)) > key) {
+            --position;
+        }
+        hand.insert(position, card);
+    }
+    else {
+        hand.push_back(card);
+    }
+}
+
+//it replaces the hand and rebuilds the hand counts to match
+void Player::setHand(const std::vector<Card>& newHand) {
+    hand = newHand;
+    handCounts = HandCounts(hand);
+    handSorted = false;
 }
 
 //it returns the number of cards currently in the players hand
@@ -489,66 +966,172 @@ const std::vector<Card>& Player::getHand() const {
 
 //it lets the AI choose the best color when playing a wild card
 cardColor Player::chooseBestColor(const Card& topCard) const {
-    //it counts how many cards of each color the AI has
-    map<cardColor, int> colorCount;
-    for (const auto& card : hand) {
-        if (card.color != WILDS) { //it doesnt count wild cards
-            colorCount[card.color]++;
+    //it picks the color with the most cards, which GameSnapshot uses too so both play wilds the same way
+    return handCounts.bestColor();
+}
+
+//it sorts the hand primarily by color and then by type
+//cards with the same color and type are the same card, so counting each of the 5x15 keys
+//and writing the cards back in key order sorts the hand in place without any buffer
+void Player::sortHand()
+{
+    UNO_TIME_SCOPE(PROBE_SORT_HAND);
+    if (handSorted) {
+        return;
+    }
+
+    int keyCounts[5 * 15] = {};
+    for (const Card& card : hand) {
+        keyCounts[sortKey(card)]++;
+    }
+
+    int write = 0;
+    for (int key = 0; key < 5 * 15; key++) {
+        for (int c = 0; c < keyCounts[key]; c++) {
+            hand[write++] = { static_cast<cardColor>(key / 15), static_cast<cardValue>(key % 15) };
         }
     }
+    handSorted = true;
+}
+
+// ---- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG ----
+
+//it frees the GLPK environment of a thread when the thread ends
+//GLPK keeps one environment per thread (TLS=_Thread_local), so a thread that is not freed leaks it
+struct GLPKThreadEnvironment {
+    ~GLPKThreadEnvironment() { glp_free_env(); }
+};
+
+//it is called before a thread makes its first problem, so the environment is destroyed after every problem of the thread
+static void keepGLPKEnvironmentForThisThread() {
+    static thread_local GLPKThreadEnvironment environment;
+}
+
+//it creates the persistent GLPK problem with the play-exactly-one-card row
+LPSolverContext::LPSolverContext() : lp(nullptr), numCols(0), numExtraRows(0) {
+    keepGLPKEnvironmentForThisThread();
+    lp = glp_create_prob();
+    glp_set_obj_dir(lp, GLP_MAX); //it tells the solver to maximize utility
+    glp_add_rows(lp, 1);
+    glp_set_row_bnds(lp, 1, GLP_FX, 1.0, 1.0); //it makes the sum equal exactly 1.0 so only one card is played
+    indices.push_back(0); //it leaves slot 0 unused because GLPK arrays are 1-indexed
+    values.push_back(0.0);
+}
+
+//it frees the problem
+LPSolverContext::~LPSolverContext() {
+    glp_delete_prob(lp);
+}
 
-    //it finds the color with the most cards
-    cardColor bestColor = REDS; //it defaults to red if no cards
-    int maxCount = 0;
-    for (const auto& pair : colorCount) {
-        if (pair.second > maxCount) {
-            maxCount = pair.second;
-            bestColor = pair.first;
+//it gets the context for the calling thread so simulator threads never share a GLPK problem
+LPSolverContext& LPSolverContext::forThisThread() {
+    static thread_local LPSolverContext context;
+    return context;
+}
+
+//it grows or shrinks the columns so the problem is reused instead of rebuilt
+void LPSolverContext::resize(int cols) {
+    if (cols > numCols) {
+        int first = glp_add_cols(lp, cols - numCols);
+        for (int j = first; j <= cols; j++) {
+            glp_set_col_kind(lp, j, GLP_BV); //it makes this a binary variable so it can only be 0 or 1
+        }
+    }
+    else if (cols < numCols) {
+        //it deletes the last columns and GLPK wants their 1-indexed numbers
+        indices.resize(numCols - cols + 1);
+        for (int j = cols + 1; j <= numCols; j++) {
+            indices[j - cols] = j;
         }
+        glp_del_cols(lp, numCols - cols, indices.data());
     }
-    return bestColor;
+    numCols = cols;
+
+    indices.resize(cols + 1);
+    values.resize(cols + 1);
 }
 
-//performs a radix sort on this player's hand
-//sorts primarily by color, then by number
-void Player::sortHand()
-{
-    //it creates 15 queues for sorting the cards into buckets
-    vector<queue<Card>> sortQueues;
-    sortQueues.resize(15, queue<Card>());
+//it picks exactly one variable and only pays for GLPK when a real extra constraint is present
+int LPSolverContext::solvePickOne(const std::vector<double>& utilities,
+                                  const std::vector<LPConstraint>& extraConstraints) {
+    int n = utilities.size();
+    if (n == 0) return -1;
+
+    //it solves the plain pick-one problem in closed form since its optimum is just the best utility
+    if (extraConstraints.empty()) {
+        int best = 0;
+        for (int i = 1; i < n; i++) {
+            if (utilities[i] > utilities[best]) best = i;
+        }
+        return best;
+    }
 
-    //it performs two passes first by type then by color
-    for (int sortByCol = 0; sortByCol < 2; sortByCol++)
     {
-        //it distributes cards into appropriate buckets
-        for (Card current : hand)
-        {
-            if (sortByCol)
-                sortQueues[current.color].push(current); //it sorts by color
-            else
-                sortQueues[current.type].push(current);  //it sorts by type
+        UNO_TIME_SCOPE(PROBE_GLPK_BUILD);
+        resize(n);
+
+        //it sets the objective and the sum of all variables equals 1 row
+        for (int i = 0; i < n; i++) {
+            glp_set_obj_coef(lp, i + 1, utilities[i]);
+            indices[i + 1] = i + 1;
+            values[i + 1] = 1.0;
         }
+        glp_set_mat_row(lp, 1, n, indices.data(), values.data());
 
-        //it clears the hand to rebuild it in sorted order
-        hand.clear();
-
-        //it collects cards back from buckets in order
-        for (queue<Card> &bucket : sortQueues)
-        {
-            while (!bucket.empty())
-            {
-                hand.push_back(bucket.front());
-                bucket.pop();
+        //it replaces the extra rows from the last call with the new ones
+        if (numExtraRows > 0) {
+            std::vector<int> rows(numExtraRows + 1);
+            for (int r = 1; r <= numExtraRows; r++) rows[r] = r + 1;
+            glp_del_rows(lp, numExtraRows, rows.data());
+        }
+        numExtraRows = extraConstraints.size();
+        int firstRow = glp_add_rows(lp, numExtraRows);
+        for (int r = 0; r < numExtraRows; r++) {
+            const LPConstraint& constraint = extraConstraints[r];
+            int len = 0;
+            for (int i = 0; i < n && i < (int)constraint.coefficients.size(); i++) {
+                if (constraint.coefficients[i] != 0.0) {
+                    len++;
+                    indices[len] = i + 1;
+                    values[len] = constraint.coefficients[i];
+                }
             }
+            glp_set_mat_row(lp, firstRow + r, len, indices.data(), values.data());
+
+            //it picks the GLPK bound type since an infinite or equal bound needs its own type
+            bool hasLower = constraint.lower > -std::numeric_limits<double>::infinity();
+            bool hasUpper = constraint.upper < std::numeric_limits<double>::infinity();
+            int type = GLP_FR;
+            if (hasLower && hasUpper) type = constraint.lower == constraint.upper ? GLP_FX : GLP_DB;
+            else if (hasLower) type = GLP_LO;
+            else if (hasUpper) type = GLP_UP;
+            glp_set_row_bnds(lp, firstRow + r, type, constraint.lower, constraint.upper);
         }
     }
 
-    //with help from https://visualgo.net/en/sorting
-    //and https://en.wikipedia.org/wiki/Radix_sort
+    //it solves the binary program directly with the presolver so no separate simplex call is needed
+    glp_iocp parm;
+    glp_init_iocp(&parm);
+    parm.presolve = GLP_ON;
+    parm.msg_lev = GLP_MSG_OFF;
+    int result;
+    {
+        UNO_TIME_SCOPE(PROBE_GLPK_INTOPT);
+        result = glp_intopt(lp, &parm);
+    }
+    if (result != 0) return -1;
+    int status = glp_mip_status(lp);
+    if (status != GLP_OPT && status != GLP_FEAS) return -1;
+
+    //it extracts the solution to find which variable was selected
+    for (int i = 0; i < n; i++) {
+        if (glp_mip_col_val(lp, i + 1) > 0.5) { //it should be exactly 1 but uses 0.5 for safety
+            return i;
+        }
+    }
+    return -1;
 }
 
-// ---- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG -------- LINEAR PROG ----
-
 //it helps to get the value of each card
 //it keeps the old calcCard for compatibility but marks it as legacy
 CardScore LPOptimizer::calcCard(const Card& card, const Card& topCard, int handSize, int opponentHandSize) {
@@ -557,7 +1140,9 @@ CardScore LPOptimizer::calcCard(const Card& card, const Card& topCard, int handS
     //it is the legacy scoring that is used for reference
     score.attackingValue = calcAttackingValue(card, handSize);
     score.defendingValue = calcDefendingValue(card, opponentHandSize);
-    score.strategicValue = 0.6 * score.attackingValue + 0.4 * score.defendingValue;
+    const AIWeights& weights = AIWeights::active();
+    score.strategicValue = weights[WEIGHT_ATTACKING_SHARE] * score.attackingValue
+        + weights[WEIGHT_DEFENDING_SHARE] * score.defendingValue;
 
     //it is the LP-based value
     score.lpOptimalValue = getCardUtility(card, handSize, opponentHandSize);
@@ -567,74 +1152,298 @@ CardScore LPOptimizer::calcCard(const Card& card, const Card& topCard, int handS
 
 //it calculates how good a card is for attacking and advancing toward victory
 double LPOptimizer::calcAttackingValue(const Card& card, int handSize) {
-    double value = 0.0;
+    //it reads the value from the table that attackingValueRule filled at compile time
+    return attackingValueLookup(card.type, handSize);
+}
 
-    //it assigns base values for each card type
-    switch (card.type) {
-        case WILD:
-            value = 0.5;
-            break;
-        case WILD_DRAW_FOUR:
-            value = 0.7;
-            break;
-        case DRAW_TWO:
-            value = 0.4;
-            break;
-        case REVERSE:
-            value = 0.35;
-            break;
-        case SKIP:
-            value = 0.35;
-            break;
-        default:
-            value = 0.2 + (card.type * 0.01);
-            break;
-    }
+//it calculates how good a card is for defending and disrupting the opponent
+double LPOptimizer::calcDefendingValue(const Card& card, int opponentHandSize) {
+    //it reads the value from the table that defendingValueRule filled at compile time
+    return defendingValueLookup(card.type, opponentHandSize);
+}
+
+//it is the simplex iterations allowed per row of the MIP relaxation, which stands in for a time limit
+//since the relaxation of a hand is solved in far fewer and tm_lim cannot be set below a millisecond
+const int MIP_SIMPLEX_ITERATIONS_PER_ROW = 4;
 
-    //it modifies the value based on game state
-    if (handSize <= 3) {
-        value *= 1.5;
+//it creates the planner with an empty problem that is refilled on every plan
+MIPPlanner::MIPPlanner(double budgetUs) : lp(nullptr), timeBudgetUs(budgetUs) {
+    keepGLPKEnvironmentForThisThread();
+    lp = glp_create_prob();
+}
+
+//it frees the problem
+MIPPlanner::~MIPPlanner() {
+    glp_delete_prob(lp);
+}
+
+//it gets the planner for the calling thread so simulator threads never share a GLPK problem
+MIPPlanner& MIPPlanner::forThisThread() {
+    static thread_local MIPPlanner planner;
+    return planner;
+}
+
+//it is the data handed to the GLPK callback so it can offer the warm-start plans as starting solutions
+//and stop the search at the deadline, which tm_lim in whole milliseconds cannot express under one
+struct MIPWarmStart {
+    std::vector<std::vector<double>> solutions; //it is each plan as 1-indexed column values
+    bool offered;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+//it gives GLPK the warm-start plans the first time it asks for a heuristic solution
+//and ends the search at the first callback past the deadline, keeping the best plan found so far
+static void mipWarmStartCallback(glp_tree* tree, void* info) {
+    MIPWarmStart* warmStart = static_cast<MIPWarmStart*>(info);
+    if (std::chrono::steady_clock::now() >= warmStart->deadline) {
+        glp_ios_terminate(tree);
+        return;
     }
-    else if (handSize > 7) {
-        if (card.type == DRAW_TWO || card.type == WILD_DRAW_FOUR) {
-            value *= 1.3;
+    if (glp_ios_reason(tree) == GLP_IHEUR && !warmStart->offered) {
+        for (const auto& x : warmStart->solutions) {
+            glp_ios_heur_sol(tree, x.data());
         }
+        warmStart->offered = true;
     }
-    return value;
 }
 
-//it calculates how good a card is for defending and disrupting the opponent
-double LPOptimizer::calcDefendingValue(const Card& card, int opponentHandSize) {
-    double value = 0.0;
+//it builds and solves the multi-turn MIP
+//x[c][t] = 1 means card c is played on turn t
+TurnPlan MIPPlanner::plan(const std::vector<Card>& hand, const Card& topCard,
+                          const SeatView& seats, int numTurns, int seat) {
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double, std::micro>(timeBudgetUs));
+    std::vector<Card>& lastPlan = lastPlanCards[max(0, min(seat, MAX_SEATS - 1))];
+    int n = hand.size();
 
-    //it makes wild cards excellent for defense
-    if (card.type == WILD || card.type == WILD_DRAW_FOUR) {
-        value = 0.8;
+    TurnPlan bestPlan;
+    bestPlan.expectedUtility = -std::numeric_limits<double>::infinity();
+
+    HandCounts counts(hand);
+    if (!counts.canPlay(topCard)) {
+        bestPlan.expectedHandSize = n + 1; //it will draw a card
+        lastPlan.clear();
+        return bestPlan;
+    }
+
+    //it keeps the plan of this turn as the warm start of the next one, whichever plan it is
+    auto rememberPlan = [&](const TurnPlan& plan) {
+        lastPlan.clear();
+        for (int idx : plan.cardSequence) {
+            lastPlan.push_back(hand[idx]);
+        }
+        return plan;
+    };
+
+    //it is the whole microseconds left before the deadline, which can be 0 or less
+    auto remainingUs = [&]() {
+        return (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+    };
+
+    numTurns = max(1, min(min(numTurns, n), MAX_PLAN_DEPTH));
+    int numCols = n * numTurns;
+    auto col = [n](int card, int turn) { return turn * n + card + 1; };
+
+    //it makes the greedy sequence plan which is both a warm start and the fallback
+    TurnPlan greedyPlan = LPOptimizer::planNextTurns(hand, topCard, seats, numTurns);
+    if (remainingUs() <= 0) return rememberPlan(greedyPlan);
+
+    //it refills the persistent problem from scratch since the hand changes every turn
+    glp_erase_prob(lp);
+    glp_set_obj_dir(lp, GLP_MAX);
+    glp_add_cols(lp, numCols);
+
+    //it sets the objective from the same coefficients the sequence evaluator uses
+    //each card played also gets the hand-size bonus and the utility sees the hand shrinking turn by turn
+    const AIWeights& weights = AIWeights::active();
+    for (int t = 0; t < numTurns; t++) {
+        for (int c = 0; c < n; c++) {
+            const Card& card = hand[c];
+            double utility = weights.cardUtility(card.type, n - t, seats.hitHandSize[0])
+                + LPOptimizer::getCardVersatility(card, counts) / (t + 1)
+                - seats.blockingProbability(card, 0) * weights[WEIGHT_BLOCK_PENALTY]
+                + card.getPointValue() * weights[WEIGHT_POINT_BONUS] * (numTurns - t)
+                + weights[WEIGHT_LENGTH_BONUS];
+            glp_set_col_kind(lp, col(c, t), GLP_BV);
+            glp_set_obj_coef(lp, col(c, t), utility);
+
+            //it only lets cards that match the top card be played on the first turn
+            if (t == 0 && !card.matches(topCard)) {
+                glp_set_col_bnds(lp, col(c, t), GLP_FX, 0.0, 0.0);
+            }
+        }
     }
-    else if (card.type == DRAW_TWO) {
-        value = 0.6;
+
+    //it is the rows: play one card now, no gaps between turns, each card once, and each card chains on the last
+    int numRows = 1 + (numTurns - 1) + n + n * (numTurns - 1);
+    glp_add_rows(lp, numRows);
+    rowIndices.assign(1, 0);
+    colIndices.assign(1, 0);
+    matrixValues.assign(1, 0.0);
+    auto addEntry = [this](int row, int column, double value) {
+        rowIndices.push_back(row);
+        colIndices.push_back(column);
+        matrixValues.push_back(value);
+    };
+
+    int row = 1;
+    glp_set_row_bnds(lp, row, GLP_FX, 1.0, 1.0);
+    for (int c = 0; c < n; c++) addEntry(row, col(c, 0), 1.0);
+    row++;
+
+    for (int t = 1; t < numTurns; t++, row++) {
+        glp_set_row_bnds(lp, row, GLP_UP, 0.0, 0.0); //it plays on turn t only if it played on turn t-1
+        for (int c = 0; c < n; c++) {
+            addEntry(row, col(c, t), 1.0);
+            addEntry(row, col(c, t - 1), -1.0);
+        }
     }
-    else {
-        value = 0.2;
+
+    for (int c = 0; c < n; c++, row++) {
+        glp_set_row_bnds(lp, row, GLP_UP, 0.0, 1.0); //it plays each card at most once
+        for (int t = 0; t < numTurns; t++) addEntry(row, col(c, t), 1.0);
     }
 
-    //it boosts value if opponent is close to winning
-    if (opponentHandSize <= 2) {
-        if (card.type == DRAW_TWO || card.type == WILD_DRAW_FOUR) {
-            value *= 1.5;
+    for (int t = 1; t < numTurns; t++) {
+        for (int c = 0; c < n; c++, row++) {
+            //it plays card c on turn t only if the card on turn t-1 is one that c matches
+            glp_set_row_bnds(lp, row, GLP_UP, 0.0, 0.0);
+            addEntry(row, col(c, t), 1.0);
+            for (int prev = 0; prev < n; prev++) {
+                if (prev != c && hand[c].matches(hand[prev])) {
+                    addEntry(row, col(prev, t - 1), -1.0);
+                }
+            }
         }
     }
-    return value;
+    glp_load_matrix(lp, rowIndices.size() - 1, rowIndices.data(), colIndices.data(), matrixValues.data());
+
+    //it warm-starts from the rest of the last plan if it is still in the hand and still chains from the top card
+    MIPWarmStart warmStart;
+    warmStart.offered = false;
+    warmStart.deadline = deadline;
+    auto addWarmStart = [&](const PlanSequence& sequence) {
+        std::vector<double> x(numCols + 1, 0.0);
+        for (int t = 0; t < (int)sequence.size() && t < numTurns; t++) {
+            x[col(sequence[t], t)] = 1.0;
+        }
+        warmStart.solutions.push_back(x);
+    };
+
+    if (lastPlan.size() > 1) {
+        PlanSequence sequence;
+        std::vector<bool> used(n, false);
+        Card currentTop = topCard;
+        for (size_t i = 1; i < lastPlan.size() && sequence.size() < numTurns; i++) {
+            int found = -1;
+            for (int c = 0; c < n; c++) {
+                if (!used[c] && hand[c].color == lastPlan[i].color && hand[c].type == lastPlan[i].type) {
+                    found = c;
+                    break;
+                }
+            }
+            if (found == -1 || !hand[found].matches(currentTop)) break;
+            used[found] = true;
+            sequence.push_back(found);
+            currentTop = hand[found];
+        }
+        if (!sequence.empty()) addWarmStart(sequence);
+    }
+    if (!greedyPlan.cardSequence.empty()) addWarmStart(greedyPlan.cardSequence);
+
+    //it solves the relaxation and then the binary program within what is left of the time budget
+    //tm_lim is in whole milliseconds and a budget under one would round to a limit GLPK stops at right away,
+    //so it keeps the default and bounds simplex by iterations and intopt by the deadline of the callback
+    if (remainingUs() <= 0) return rememberPlan(greedyPlan);
+    bool solved = false;
+    glp_smcp smcp;
+    glp_init_smcp(&smcp);
+    smcp.msg_lev = GLP_MSG_OFF;
+    smcp.it_lim = MIP_SIMPLEX_ITERATIONS_PER_ROW * glp_get_num_rows(lp) + numCols;
+    int simplexResult;
+    {
+        UNO_TIME_SCOPE(PROBE_GLPK_SIMPLEX);
+        simplexResult = glp_simplex(lp, &smcp);
+    }
+    if (simplexResult == 0 && glp_get_status(lp) == GLP_OPT && remainingUs() > 0) {
+        glp_iocp parm;
+        glp_init_iocp(&parm);
+        parm.msg_lev = GLP_MSG_OFF;
+        parm.presolve = GLP_OFF; //it keeps the original columns so the warm-start solutions line up
+        parm.cb_func = mipWarmStartCallback;
+        parm.cb_info = &warmStart;
+        {
+            UNO_TIME_SCOPE(PROBE_GLPK_INTOPT);
+            glp_intopt(lp, &parm);
+        }
+        int status = glp_mip_status(lp);
+        solved = (status == GLP_OPT || status == GLP_FEAS);
+    }
+
+    if (solved) {
+        //it reads the card played on each turn until the plan stops or stops chaining
+        Card currentTop = topCard;
+        for (int t = 0; t < numTurns; t++) {
+            int played = -1;
+            for (int c = 0; c < n; c++) {
+                if (glp_mip_col_val(lp, col(c, t)) > 0.5) {
+                    played = c;
+                    break;
+                }
+            }
+            if (played == -1 || !hand[played].matches(currentTop)) break;
+            bestPlan.cardSequence.push_back(played);
+            currentTop = hand[played];
+        }
+        bestPlan.expectedUtility = glp_mip_obj_val(lp);
+        bestPlan.expectedHandSize = n - bestPlan.cardSequence.size();
+    }
+
+    //it falls back to the greedy plan when the solver ran out of time without a plan
+    if (bestPlan.cardSequence.empty()) {
+        UNO_COUNT(COUNTER_MIP_FALLBACKS, 1);
+        bestPlan = greedyPlan;
+    } else {
+        UNO_COUNT(COUNTER_MIP_PLANS, 1);
+    }
+
+    return rememberPlan(bestPlan);
 }
 
 // ------- DECK -------------- DECK -------------- DECK -------------- DECK -------------- DECK -------------- DECK -------
 
+//it moves the state 2^128 steps ahead with the published xoshiro256 jump polynomial
+void FastRng::jump() {
+    static const uint64_t JUMP[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                     0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+    uint64_t t[4] = { 0, 0, 0, 0 };
+    for (uint64_t word : JUMP) {
+        for (int b = 0; b < 64; b++) {
+            if (word & (1ULL << b)) {
+                for (int i = 0; i < 4; i++) t[i] ^= s[i];
+            }
+            (*this)();
+        }
+    }
+    for (int i = 0; i < 4; i++) s[i] = t[i];
+}
+
 //it initializes the random number generator for shuffling
-Deck::Deck()
+//it only asks random_device once per thread and splits a new stream off that for every deck
+Deck::Deck() : colorCounts{}, infinite(false)
 {
-    rng = std::mt19937(std::random_device{}());
+    thread_local FastRng streams(((uint64_t)std::random_device{}() << 32) ^ std::random_device{}());
+    rng = streams.split();
 }
 
+//it seeds the random number generator so the same seed gives the same shuffles
+Deck::Deck(unsigned int seed) : colorCounts{}, rng(seed), infinite(false) {}
+
+//it uses a generator that was already seeded or split off another one
+Deck::Deck(const FastRng& rng) : colorCounts{}, rng(rng), infinite(false) {}
+
 //it creates a complete standard UNO deck with all 108 cards
 void Deck::initinialize() {
     cards.clear();
@@ -665,27 +1474,56 @@ void Deck::initinialize() {
         cards.push_back({ WILDS, WILD_DRAW_FOUR });
     }
 
+    for (int c = 0; c < 5; c++) {
+        colorCounts[c] = FULL_DECK_COLORS[c];
+    }
     shuffle();
 }
 
 //it randomizes the order of all cards in the deck
+//it is a Fisher-Yates shuffle on FastRng::below so a seed gives the same order with every standard library
 void Deck::shuffle() {
-    std::shuffle(std::begin(cards), std::end(cards), rng);
+    for (int i = cards.size() - 1; i > 0; i--) {
+        std::swap(cards[i], cards[rng.below(i + 1)]);
+    }
 }
 
-//it draws a random card when the deck is conceptually infinite
-Card Deck::draw() {
-    Card drawn;
-    std::uniform_int_distribution<int> dist(0, 14);
-    drawn.type = cardValue(dist(rng));
-    if (drawn.isWild())
-        drawn.color = WILDS;
-    else
-    {
-        uniform_int_distribution<int> colDist(0, 3);
-        drawn.color = cardColor(colDist(rng));
+//it draws the next card off the back of the pile
+bool Deck::draw(Card& card) {
+    //it makes a random card when the deck is conceptually infinite
+    if (infinite) {
+        card.type = cardValue(rng.below(15));
+        if (card.isWild())
+            card.color = WILDS;
+        else
+            card.color = cardColor(rng.below(4));
+        return true;
     }
-    return drawn;
+
+    if (cards.empty()) {
+        return false;
+    }
+    card = cards.back();
+    cards.pop_back();
+    colorCounts[countedColor(card)]--;
+    return true;
+}
+
+//it moves the other piles cards into this one so a used discard pile becomes the new deck
+void Deck::recycleFrom(Deck& other) {
+    for (Card card : other.cards) {
+        //it clears the color that was chosen for a played wild
+        if (card.isWild()) {
+            card.colorChange(WILDS);
+        }
+        cards.push_back(card);
+        colorCounts[countedColor(card)]++;
+    }
+    other.cards.clear();
+    for (int c = 0; c < 5; c++) {
+        other.colorCounts[c] = 0;
+    }
+    shuffle();
 }
 
 //it returns true if there are no cards left in the deck
@@ -701,18 +1539,40 @@ int Deck::size() const {
 //it adds a card to the deck typically from the discard pile
 void Deck::addCard(const Card& card) {
     cards.push_back(card);
+    colorCounts[countedColor(card)]++;
+}
+
+void Deck::setCards(const std::vector<Card>& newCards) {
+    cards = newCards;
+    for (int c = 0; c < 5; c++) colorCounts[c] = 0;
+    for (const Card& card : cards) colorCounts[countedColor(card)]++;
+    shuffle();
+}
+
+//it reseeds the random number generator so the deck shuffles and draws differently
+void Deck::reseed(unsigned int seed) {
+    rng.seed(seed);
 }
 
 // ------- GAME -------------- GAME -------------- GAME -------------- GAME -------------- GAME -------------- GAME -------
 
 //it initializes a new game with default values
-Game::Game() : currentPlayer(0), clockwise(true), drawStack(0), state(GAME_MENU), winner(-1) {}
+Game::Game() : currentPlayer(0), clockwise(true), drawStack(0), state(GAME_MENU), winner(-1), infiniteDeck(false) {}
 
 //it sets up a new game with the specified number of players
 void Game::initialize(int numPlayers, int numAI) {
+    initialize(numPlayers, numAI, std::random_device{}());
+}
+
+//it sets up a new game with a fixed seed so the same seed replays the same deals and draws
+void Game::initialize(int numPlayers, int numAI, unsigned int seed) {
     players.clear();
+    //it splits the discard pile its own stream off the deck generator so the two never repeat each other
+    FastRng generator(seed);
+    deck = Deck(generator.split());
+    deck.setInfinite(infiniteDeck);
     deck.initinialize();
-    discardPile = Deck();
+    discardPile = Deck(generator);
     currentPlayer = 0;
     clockwise = true;
     drawStack = 0;
@@ -726,11 +1586,17 @@ void Game::initialize(int numPlayers, int numAI) {
     for (int i = 0; i < numAI; i++) {
         players.push_back(Player(true, "AI" + to_string(i + 1)));
     }
+    for (int p = 0; p < numPlayers; p++) {
+        players[p].resetTableModel(numPlayers, p);
+    }
 
     //it deals 7 cards to each player
     for (int i = 0; i < 7; i++) {
         for (auto& player : players) {
-            player.addCard(deck.draw());
+            Card card;
+            if (drawFromDeck(card)) {
+                player.addCard(card);
+            }
         }
     }
     //it sort each player's hand
@@ -738,27 +1604,53 @@ void Game::initialize(int numPlayers, int numAI) {
         player.sortHand();
     }
 
-    //it draw the initial top card
-    do {
-        topCard = deck.draw();
-    } while (topCard.isWild() || topCard.isActionCard());
+    //it draw the initial top card and puts the wild and action cards it skips on the discard pile
+    //with up to MAX_SEATS seats the deal leaves at least 38 cards and only 32 can be skipped, so the pile lasts
+    while (true) {
+        bool drawn = deck.draw(topCard);
+        assert(drawn && "the deal must leave a number card to start the discard pile");
+        (void)drawn;
+        if (!topCard.isWild() && !topCard.isActionCard()) break;
+        if (!infiniteDeck) discardPile.addCard(topCard);
+    }
+
+    //it starts a record with the seed so the deal can be replayed
+    if (recorder.writer) {
+        recorder.writer->beginGame(seed, numPlayers, numAI, infiniteDeck);
+    }
+}
+
+//it draws one card and reshuffles the discard pile into the deck first if the deck ran out
+//the top card is never in the discard pile so it stays on the table
+bool Game::drawFromDeck(Card& card) {
+    if (!deck.isInfinite() && deck.isEmpty()) {
+        if (discardPile.isEmpty()) {
+            return false;
+        }
+        deck.recycleFrom(discardPile);
+    }
+    return deck.draw(card);
 }
 
 //it executes a turn for the current player
 void Game::playTurn(int cardIndex) {
-    Player& player = players[currentPlayer];
+    UNO_TIME_SCOPE(PROBE_PLAY_TURN);
+    if (recorder.writer) {
+        recorder.writer->recordMove(*this, cardIndex);
+    }
 
-    //it gets the next player index for opponent modeling
-    int nextPlayerIdx = clockwise ?
-        (currentPlayer + 1) % players.size() :
-        (currentPlayer - 1 + players.size()) % players.size();
+    Player& player = players[currentPlayer];
+    int seat = currentPlayer;
 
     //if they are drawing a card
     if (cardIndex == -1) {
-        //it updates opponent model that this player drew instead of playing
-        if (player.getISAI() && players.size() > 1) {
-            players[nextPlayerIdx].updateOpponentModel(topCard, true);
+        //it works out which colors are left outside the discard pile and the top card for the models to draw from
+        int unseen[5];
+        for (int c = 0; c < 5; c++) {
+            unseen[c] = FULL_DECK_COLORS[c] - discardPile.getColorCount(static_cast<cardColor>(c));
         }
+        unseen[countedColor(topCard)]--;
+        int sizeBefore = player.getHandSize();
 
         if (drawStack > 0) {
             drawCards(currentPlayer, drawStack);
@@ -767,13 +1659,21 @@ void Game::playTurn(int cardIndex) {
             nextPlayer();
         }
         else {
-            player.addCard(deck.draw());
-            player.sortHand();
-            const Card& drawnCard = player.getHand().back();
-            if (!drawnCard.matches(topCard)) {
+            //it keeps a copy of the drawn card since sorting moves it away from the back of the hand
+            //and it passes when there is no card left anywhere to draw
+            Card drawnCard;
+            bool drew = drawFromDeck(drawnCard);
+            if (drew) {
+                player.addCard(drawnCard);
+                player.sortHand();
+            }
+            if (!drew || !drawnCard.matches(topCard)) {
                 nextPlayer();
             }
         }
+
+        //it tells the other players that this seat drew instead of playing
+        observeMove(seat, topCard, true, player.getHandSize() - sizeBefore, deck.isInfinite() ? nullptr : unseen);
         return;
     }
 
@@ -796,10 +1696,8 @@ void Game::playTurn(int cardIndex) {
 
     Card played = player.playCard(cardIndex);
 
-    //it updates opponent model that this player played this card
-    if (player.getISAI() && players.size() > 1) {
-        players[nextPlayerIdx].updateOpponentModel(played, false);
-    }
+    //it tells the other players which card this seat played
+    observeMove(seat, played, false, 0, nullptr);
 
     discardPile.addCard(topCard);
     topCard = played;
@@ -809,6 +1707,9 @@ void Game::playTurn(int cardIndex) {
     if (player.getHandSize() == 0) {
         winner = currentPlayer;
         state = GAME_OVER; //changes the state of the game to game over
+        if (recorder.writer) {
+            recorder.writer->endGame(*this);
+        }
         return;
     }
 
@@ -850,17 +1751,25 @@ void Game::playTurn(int cardIndex) {
 
 //it advances to the next player based on current direction
 void Game::nextPlayer() {
-    if (clockwise) {
-        currentPlayer = (currentPlayer + 1) % players.size();
-    }
-    else {
-        currentPlayer = (currentPlayer - 1 + players.size()) % players.size();
+    currentPlayer = seatAfter(currentPlayer, clockwise, players.size());
+}
+
+//it tells every other AI player what a seat did so their table models stay current
+void Game::observeMove(int seat, const Card& card, bool drew, int cardsDrawn, const int* unseenColorCounts) {
+    int newHandSize = players[seat].getHandSize();
+    for (int p = 0; p < (int)players.size(); p++) {
+        if (p != seat && players[p].getISAI()) {
+            players[p].updateOpponentModel(seat, card, drew, newHandSize, cardsDrawn, unseenColorCounts);
+        }
     }
 }
 
 //it reverses the direction of play
 void Game::reverseDirection() {
     clockwise = !clockwise;
+    for (int p = 0; p < (int)players.size(); p++) {
+        players[p].setNextSeat(seatAfter(p, clockwise, players.size()));
+    }
     if (players.size() == 2) {
         nextPlayer();
     }
@@ -874,13 +1783,11 @@ void Game::skipPlayer() {
 //it forces a player to draw multiple cards
 void Game::drawCards(int playerIndex, int count) {
     for (int i = 0; i < count; i++) {
-        if (deck.isEmpty()) {
-            while (discardPile.size() > 0) {
-                deck.addCard(discardPile.draw());
-            }
-            deck.shuffle();
+        Card card;
+        if (!drawFromDeck(card)) {
+            break; //it stops when every card is already in a hand
         }
-        players[playerIndex].addCard(deck.draw());
+        players[playerIndex].addCard(card);
     }
 }
 
@@ -896,8 +1803,25 @@ bool Game::checkWinner() {
     return false;
 }
 
+//it reseeds both piles which search AIs use so their copy of the game does not know the real future draws
+void Game::reseed(unsigned int seed) {
+    FastRng generator(seed);
+    deck.reseed(generator.split());
+    deck.shuffle();
+    discardPile.reseed(generator);
+}
+
+int Game::countCards() const {
+    int total = deck.size() + discardPile.size() + 1;
+    for (const Player& player : players) total += player.getHandSize();
+    return total;
+}
+
 //it handles the color selection after a wild card is played
 void Game::chooseColorForWild(cardColor color) {
+    if (recorder.writer) {
+        recorder.writer->recordColor(color);
+    }
     topCard.colorChange(color);
     state = GAME_PLAYING;
 
@@ -905,4 +1829,265 @@ void Game::chooseColorForWild(cardColor color) {
 
     }
     nextPlayer();
-}
\ No newline at end of file
+}
+
+//it saves the state into flat arrays, the hands by count and the draw pile in order
+bool Game::saveSnapshot(GameSnapshot& snapshot) const {
+    if (players.size() > MAX_SNAPSHOT_PLAYERS || deck.size() > DECK_SIZE) {
+        return false;
+    }
+
+    snapshot.numPlayers = players.size();
+    for (int p = 0; p < snapshot.numPlayers; p++) {
+        snapshot.hands[p] = players[p].getHandCounts();
+    }
+
+    const vector<Card>& pileCards = deck.getCards();
+    snapshot.pileSize = pileCards.size();
+    for (int i = 0; i < snapshot.pileSize; i++) {
+        snapshot.pile[i] = pileCards[i].pack();
+    }
+
+    for (int s = 0; s < HAND_SLOTS; s++) {
+        snapshot.discard[s] = 0;
+    }
+    for (const Card& card : discardPile.getCards()) {
+        snapshot.discard[HandCounts::slotOf(card)]++;
+    }
+    snapshot.discardSize = discardPile.size();
+
+    snapshot.rng = deck.getRng();
+    snapshot.topCard = topCard;
+    snapshot.currentPlayer = currentPlayer;
+    snapshot.drawStack = drawStack;
+    snapshot.winner = winner;
+    snapshot.state = state;
+    snapshot.clockwise = clockwise;
+    snapshot.infinite = deck.isInfinite();
+    return true;
+}
+
+//it loads a snapshot back, and the hands come back sorted since the snapshot keeps them by count
+void Game::restoreSnapshot(const GameSnapshot& snapshot) {
+    vector<Card> hand;
+    for (int p = 0; p < snapshot.numPlayers && p < (int)players.size(); p++) {
+        hand.clear();
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            for (int c = 0; c < snapshot.hands[p].counts[s]; c++) {
+                hand.push_back(HandCounts::cardOf(s));
+            }
+        }
+        players[p].setHand(hand);
+    }
+
+    deck = Deck(snapshot.rng);
+    deck.setInfinite(snapshot.infinite);
+    for (int i = 0; i < snapshot.pileSize; i++) {
+        deck.addCard(Card::unpack(snapshot.pile[i]));
+    }
+
+    discardPile = Deck(discardPile.getRng());
+    for (int s = 0; s < HAND_SLOTS; s++) {
+        for (int c = 0; c < snapshot.discard[s]; c++) {
+            discardPile.addCard(HandCounts::cardOf(s));
+        }
+    }
+
+    topCard = snapshot.topCard;
+    currentPlayer = snapshot.currentPlayer;
+    drawStack = snapshot.drawStack;
+    winner = snapshot.winner;
+    state = snapshot.state;
+    clockwise = snapshot.clockwise;
+    for (int p = 0; p < (int)players.size(); p++) {
+        players[p].setNextSeat(seatAfter(p, clockwise, players.size()));
+    }
+}
+
+// ------- SNAPSHOT -------------- SNAPSHOT -------------- SNAPSHOT -------------- SNAPSHOT -------------- SNAPSHOT -------
+
+//it draws cards the way Game::drawFromDeck does, reshuffling the discard pile when the draw pile runs out
+//a draw stack in infinite mode is capped at DECK_SIZE cards since that is all undo can hold
+void GameSnapshot::drawCards(int seat, int count, SnapshotUndo& undo) {
+    count = min(count, DECK_SIZE);
+    for (int i = 0; i < count; i++) {
+        Card card;
+        if (infinite) {
+            card.type = cardValue(rng.below(15));
+            card.color = card.isWild() ? WILDS : cardColor(rng.below(4));
+        }
+        else {
+            if (pileSize == 0) {
+                if (discardSize == 0) {
+                    break; //it stops when every card is already in a hand
+                }
+
+                //it lays the discarded cards out by slot and shuffles them the same way Deck::shuffle does
+                for (int s = 0; s < HAND_SLOTS; s++) {
+                    for (int c = 0; c < discard[s]; c++) {
+                        pile[pileSize++] = HandCounts::cardOf(s).pack();
+                    }
+                    discard[s] = 0;
+                }
+                discardSize = 0;
+                for (int j = pileSize - 1; j > 0; j--) {
+                    std::swap(pile[j], pile[rng.below(j + 1)]);
+                }
+                undo.reshuffled = true;
+            }
+            card = Card::unpack(pile[--pileSize]);
+        }
+        hands[seat].add(card);
+        undo.drawn[undo.drawnCount++] = card.pack();
+    }
+}
+
+//it plays a move with the same rules as Game::playTurn
+bool GameSnapshot::apply(int move, SnapshotUndo& undo, cardColor wildColor) {
+    if (state != GAME_PLAYING) {
+        return false;
+    }
+
+    HandCounts& hand = hands[currentPlayer];
+    Card played;
+    if (move != SNAPSHOT_DRAW_MOVE) {
+        if (move < 0 || move >= HAND_SLOTS || hand.counts[move] == 0) {
+            return false;
+        }
+        played = HandCounts::cardOf(move);
+        if (!played.matches(topCard)) {
+            return false;
+        }
+        if (drawStack > 0 && played.type != DRAW_TWO && played.type != WILD_DRAW_FOUR) {
+            return false;
+        }
+    }
+
+    undo.rng = rng;
+    undo.topCard = topCard;
+    undo.currentPlayer = currentPlayer;
+    undo.drawStack = drawStack;
+    undo.pileSize = pileSize;
+    undo.drawer = currentPlayer;
+    undo.playedSlot = move == SNAPSHOT_DRAW_MOVE ? -1 : move;
+    undo.state = state;
+    undo.winner = winner;
+    undo.clockwise = clockwise;
+    undo.reshuffled = false;
+    undo.drawnCount = 0;
+
+    //it draws the whole stack and passes, or draws one card and keeps the turn if that card can be played
+    if (move == SNAPSHOT_DRAW_MOVE) {
+        if (drawStack > 0) {
+            drawCards(currentPlayer, drawStack, undo);
+            drawStack = 0;
+            currentPlayer = Game::seatAfter(currentPlayer, clockwise, numPlayers);
+        }
+        else {
+            drawCards(currentPlayer, 1, undo);
+            if (undo.drawnCount == 0 || !Card::unpack(undo.drawn[0]).matches(topCard)) {
+                currentPlayer = Game::seatAfter(currentPlayer, clockwise, numPlayers);
+            }
+        }
+        return true;
+    }
+
+    hand.remove(played);
+    discard[HandCounts::slotOf(topCard)]++;
+    discardSize++;
+    topCard = played;
+
+    if (hand.total == 0) {
+        winner = currentPlayer;
+        state = GAME_OVER;
+        return true;
+    }
+
+    switch (played.type) {
+    case SKIP:
+        currentPlayer = Game::seatAfter(currentPlayer, clockwise, numPlayers);
+        break;
+    case REVERSE:
+        clockwise = !clockwise;
+        if (numPlayers == 2) {
+            currentPlayer = Game::seatAfter(currentPlayer, clockwise, numPlayers);
+        }
+        break;
+    case DRAW_TWO:
+        drawStack += 2;
+        break;
+    case WILD_DRAW_FOUR:
+        drawStack += 4;
+        break;
+    default:
+        break;
+    }
+
+    if (played.isWild()) {
+        topCard.colorChange(wildColor == WILDS ? hand.bestColor() : wildColor);
+    }
+    currentPlayer = Game::seatAfter(currentPlayer, clockwise, numPlayers);
+    return true;
+}
+
+//it puts back the drawn cards and the played card and restores the fields the move changed
+void GameSnapshot::undo(const SnapshotUndo& undo) {
+    for (int i = undo.drawnCount - 1; i >= 0; i--) {
+        hands[undo.drawer].remove(Card::unpack(undo.drawn[i]));
+    }
+
+    if (!infinite) {
+        //it sends the reshuffled cards that were not drawn back to the discard pile
+        if (undo.reshuffled) {
+            int drawnFromOldPile = undo.pileSize;
+            for (int i = 0; i < pileSize; i++) {
+                discard[HandCounts::slotOf(Card::unpack(pile[i]))]++;
+            }
+            for (int i = drawnFromOldPile; i < undo.drawnCount; i++) {
+                discard[HandCounts::slotOf(Card::unpack(undo.drawn[i]))]++;
+            }
+            discardSize = pileSize + undo.drawnCount - drawnFromOldPile;
+        }
+
+        //it stacks the cards drawn from the old pile back on it in the order they came off
+        int fromOldPile = undo.reshuffled ? undo.pileSize : undo.drawnCount;
+        for (int i = 0; i < fromOldPile; i++) {
+            pile[undo.pileSize - 1 - i] = undo.drawn[i];
+        }
+        pileSize = undo.pileSize;
+    }
+
+    if (undo.playedSlot != -1) {
+        hands[undo.currentPlayer].add(HandCounts::cardOf(undo.playedSlot));
+        discard[HandCounts::slotOf(undo.topCard)]--;
+        discardSize--;
+    }
+
+    rng = undo.rng;
+    topCard = undo.topCard;
+    currentPlayer = undo.currentPlayer;
+    drawStack = undo.drawStack;
+    winner = undo.winner;
+    state = undo.state;
+    clockwise = undo.clockwise;
+}
+
+//it lists the playable slots of the current player and the draw, which is always allowed
+int GameSnapshot::legalMoves(int* moves) const {
+    if (state != GAME_PLAYING) {
+        return 0;
+    }
+
+    uint64_t playable = hands[currentPlayer].playable(topCard);
+    if (drawStack > 0) {
+        playable &= HandCounts::typeMask(DRAW_TWO) | HandCounts::typeMask(WILD_DRAW_FOUR);
+    }
+
+    int count = 0;
+    while (playable) {
+        moves[count++] = std::countr_zero(playable);
+        playable &= playable - 1;
+    }
+    moves[count++] = SNAPSHOT_DRAW_MOVE;
+    return count;
+}
@@ -1,10 +1,14 @@
 #ifndef DECK_H
 #define DECK_H
 
+#include <cassert>
 #include <vector>
 #include <string>
 #include <random>
 #include <map>
+#include <cstdint>
+#include <bit>
+#include <type_traits>
 
 //it is the card colors in UNO
 enum cardColor {
@@ -56,6 +60,131 @@ struct Card {
         if (type == WILD || type == WILD_DRAW_FOUR) return 50;
         return 0;
     }
+
+    //it packs the card into one byte with the color in the high bits and the type in the low 4 bits
+    uint8_t pack() const {
+        return static_cast<uint8_t>((color << 4) | type);
+    }
+
+    //it unpacks a card that was packed with pack()
+    static Card unpack(uint8_t packed) {
+        return { static_cast<cardColor>(packed >> 4), static_cast<cardValue>(packed & 0x0F) };
+    }
+};
+
+//it is the number of distinct cards a hand can hold
+//slots 0-51 are the 4 colors times the 13 colored types and slots 52-53 are the two wilds
+const int HAND_SLOTS = 54;
+const int COLORED_TYPES = 13;
+
+//it is the hand stored as a count per distinct card plus a bit mask of which slots are not empty
+//it lets "can anything be played" and "how many cards of this color/type" be answered with a few bit operations
+struct HandCounts {
+    uint8_t counts[HAND_SLOTS];  //it counts how many copies of each distinct card are held
+    uint64_t present;            //it has bit s set when counts[s] is not zero
+    uint8_t colorCounts[5];      //it counts the cards of each color including WILDS
+    uint8_t typeCounts[15];      //it counts the cards of each type
+    int total;                   //it is the total number of cards
+
+    HandCounts() { clear(); }
+
+    //it builds the counts from a hand of cards
+    explicit HandCounts(const std::vector<Card>& hand) {
+        clear();
+        for (const auto& card : hand) add(card);
+    }
+
+    //it empties the hand
+    void clear() {
+        for (auto& c : counts) c = 0;
+        for (auto& c : colorCounts) c = 0;
+        for (auto& c : typeCounts) c = 0;
+        present = 0;
+        total = 0;
+    }
+
+    //it gets the slot of a card which is its color row and type column, or one of the two wild slots
+    static int slotOf(const Card& card) {
+        if (card.isWild()) return COLORED_TYPES * 4 + (card.type - WILD);
+        return card.color * COLORED_TYPES + card.type;
+    }
+
+    //it gets the card that is stored in a slot
+    static Card cardOf(int slot) {
+        if (slot >= COLORED_TYPES * 4) return { WILDS, static_cast<cardValue>(WILD + slot - COLORED_TYPES * 4) };
+        return { static_cast<cardColor>(slot / COLORED_TYPES), static_cast<cardValue>(slot % COLORED_TYPES) };
+    }
+
+    //it adds a card to the hand
+    void add(const Card& card) {
+        int slot = slotOf(card);
+        counts[slot]++;
+        present |= 1ULL << slot;
+        colorCounts[card.color]++;
+        typeCounts[card.type]++;
+        total++;
+    }
+
+    //it removes a card from the hand
+    void remove(const Card& card) {
+        int slot = slotOf(card);
+        if (--counts[slot] == 0) present &= ~(1ULL << slot);
+        colorCounts[card.color]--;
+        typeCounts[card.type]--;
+        total--;
+    }
+
+    //it gets the mask of every slot of one color
+    static constexpr uint64_t colorMask(cardColor color) {
+        return color == WILDS ? 0 : ((1ULL << COLORED_TYPES) - 1) << (color * COLORED_TYPES);
+    }
+
+    //it gets the mask of every slot of one type
+    static constexpr uint64_t typeMask(cardValue type) {
+        if (type == WILD || type == WILD_DRAW_FOUR) return 1ULL << (COLORED_TYPES * 4 + (type - WILD));
+        uint64_t column = 1ULL | (1ULL << COLORED_TYPES) | (1ULL << (COLORED_TYPES * 2)) | (1ULL << (COLORED_TYPES * 3));
+        return column << type;
+    }
+
+    //it gets the mask of the slots that can be played on the top card with the same rules as Card::matches
+    static constexpr uint64_t playableMask(const Card& topCard) {
+        return colorMask(topCard.color) | typeMask(topCard.type) | typeMask(WILD) | typeMask(WILD_DRAW_FOUR);
+    }
+
+    //it gets the mask of the held slots that can be played on the top card
+    uint64_t playable(const Card& topCard) const {
+        return present & playableMask(topCard);
+    }
+
+    //it checks if any held card can be played on the top card
+    bool canPlay(const Card& topCard) const {
+        return playable(topCard) != 0;
+    }
+
+    //it counts how many held cards can be played on the top card
+    int countPlayable(const Card& topCard) const {
+        uint64_t mask = playable(topCard);
+        int count = 0;
+        while (mask) {
+            int slot = std::countr_zero(mask);
+            count += counts[slot];
+            mask &= mask - 1;
+        }
+        return count;
+    }
+
+    //it gets the color the AI picks for a wild, which is the color it holds most of and red on a tie with none
+    cardColor bestColor() const {
+        cardColor best = REDS;
+        int maxCount = 0;
+        for (int c = REDS; c <= YELLOWS; c++) {
+            if (colorCounts[c] > maxCount) {
+                maxCount = colorCounts[c];
+                best = static_cast<cardColor>(c);
+            }
+        }
+        return best;
+    }
 };
 
 //it is the card score structure for evaluating cards
@@ -66,42 +195,203 @@ struct CardScore {
     double lpOptimalValue;
 };
 
+//it is the most cards of one color the opponent model keeps a probability for, more are counted in the last bucket
+const int MODEL_MAX_COLOR_CARDS = 25;
+
 //it tracks opponent behavior for modeling
+//for each color (and the wilds) it keeps a probability for every count of that color the opponent could hold
+//it starts from the chance of being dealt those cards, is narrowed by what the opponent plays and when they
+//have to draw, and is widened by the cards they draw, which come from the cards this player has not seen
+//the colors are updated one at a time without tying them to the hand size, which keeps every update small
 struct OpponentModel {
-    std::map<cardColor, int> colorsPlayed;      //it counts how many times each color was played
-    std::map<cardColor, int> colorsAvoided;     //it counts how many times each color was avoided
-    int totalTurnsObserved;                      //it counts total turns to calculate probabilities
-    int turnsWithoutPlaying;                     //it counts consecutive turns where opponent drew
+    float colorPosterior[5][MODEL_MAX_COLOR_CARDS + 1]; //it is the chance the opponent holds each count of each color
+    double probabilityHasColor[5];   //it is 1 - colorPosterior[c][0], kept so queries are a lookup
+    double expectedColorCount[5];    //it is the mean of colorPosterior[c]
+    double drawShares[5];            //it is the chance a card they draw has each color
+    int colorsPlayed[4];             //it counts how many times each color was played
+    int colorsAvoided[4];            //it counts how many times each color was avoided
+    int totalTurnsObserved;          //it counts total turns to calculate probabilities
+    int turnsWithoutPlaying;         //it counts consecutive turns where opponent drew
+    int handSize;                    //it is how many cards the opponent is thought to hold
+
+    //it initializes the opponent model for a 7 card hand dealt from a full deck
+    OpponentModel();
+
+    //it initializes the opponent model for an empty hand
+    explicit OpponentModel(int);
 
-    //it initializes the opponent model
-    OpponentModel() : totalTurnsObserved(0), turnsWithoutPlaying(0) {
-        for (int c = REDS; c <= YELLOWS; c++) {
-            colorsPlayed[static_cast<cardColor>(c)] = 0;
-            colorsAvoided[static_cast<cardColor>(c)] = 0;
-        }
+    //it estimates probability opponent has a specific color
+    double getProbabilityHasColor(cardColor color) const { return probabilityHasColor[color]; }
+
+    //it estimates how many cards of a color the opponent holds
+    double getExpectedColorCount(cardColor color) const { return expectedColorCount[color]; }
+
+    //it sets the chance of each color for the cards the opponent will draw from how many of them are unseen
+    void setUnseenCards(const int unseenColorCounts[5]);
+
+    //it records that the opponent played a card, so they held at least one of its color
+    void observePlay(const Card& card);
+
+    //it records that the opponent drew cards instead of playing on the top card
+    //a single draw means they had nothing of the top color, and a draw stack says nothing about colors
+    void observeDraw(const Card& topCard, int cardsDrawn);
+
+private:
+    //it recomputes the cached probability and mean of one color
+    void refresh(int color);
+};
+
+//it is the most seats a player keeps a model of, and the most a GameSnapshot can hold
+const int MAX_SEATS = 10;
+
+//it is what one player knows about every seat at the table
+//the values the AI reads on every move are stored as one array per field indexed by seat, so scanning the table
+//touches a few cache lines, and the full posterior of each seat sits apart since only updates read it
+//every turn only the seat that moved is updated, so the cost per turn is O(seats) over all players
+struct TableModel {
+    int numSeats;                             //it is how many seats are tracked, at most MAX_SEATS
+    int owner;                                //it is the seat of the player this model belongs to
+    int nextSeat;                             //it is the seat that plays after the owner in the current direction
+    int handSizes[MAX_SEATS];                 //it is how many cards each seat holds
+    int turnsWithoutPlaying[MAX_SEATS];
+    double probabilityHasColor[5][MAX_SEATS]; //it is the chance each seat holds each color
+    OpponentModel seats[MAX_SEATS];           //it is the posterior of each seat
+
+    TableModel() { reset(2, 0); }
+
+    //it starts a fresh model for a new game
+    void reset(int seatCount, int ownerSeat);
+
+    //it gets the full model of a seat
+    const OpponentModel& getModel(int seat) const { return seats[seat]; }
+
+    //it records a play or a draw of a seat and copies the new numbers into the arrays
+    void observePlay(int seat, const Card& card, int newHandSize);
+    void observeDraw(int seat, const Card& topCard, int cardsDrawn, const int* unseenColorCounts, int newHandSize);
+
+private:
+    void refresh(int seat);
+};
+
+//it is where the turn goes after a card: the next seat, two seats along after a skip, or back the other way
+//after a reverse
+enum TurnHandoff {
+    HANDOFF_NEXT, HANDOFF_SKIP, HANDOFF_REVERSE, HANDOFF_KINDS
+};
+
+//it is what the AI scores its cards against, worked out from the table once per decision
+//every card is scored against the seat it hands the turn to, and a draw card or a skip takes its defensive bonus
+//from the hand of the seat it hits, which is always the next one
+//a plan can turn the direction around with a reverse, so every value is kept for the current direction (0) and
+//the other one (1), and a card that gives the owner the next turn can not be blocked
+struct SeatView {
+    int hitHandSize[2];                          //it is the hand of the next seat in each direction
+    double answerHasColor[2][HANDOFF_KINDS][4];  //it is the chance the seat that moves after the card holds each color
+
+    //it views the table from the seat that owns it, where the next seat holds nextHandSize cards
+    static SeatView of(const TableModel& table, int nextHandSize);
+
+    //it views a two seat table, where a skip or a reverse gives the owner the next turn
+    static SeatView headsUp(int opponentHandSize, const OpponentModel& opponentModel);
+
+    static TurnHandoff handoffOf(cardValue type) {
+        return type == SKIP ? HANDOFF_SKIP : type == REVERSE ? HANDOFF_REVERSE : HANDOFF_NEXT;
     }
 
-    //it estimates probability opponent has a specific color
-    double getProbabilityHasColor(cardColor color) const {
-        if (totalTurnsObserved == 0) return 0.25; //it defaults to even distribution
+    //it gets the direction after a card is played in a direction
+    static int directionAfter(cardValue type, int direction) {
+        return type == REVERSE ? 1 - direction : direction;
+    }
 
-        int played = colorsPlayed.at(color);
-        int avoided = colorsAvoided.at(color);
+    //it gets the chance that the seat moving after this card can play on it
+    double blockingProbability(const Card& card, int direction) const {
+        if (card.isWild()) return 0.0; //it cant be blocked since wild changes color
+        return answerHasColor[direction][handoffOf(card.type)][card.color];
+    }
+};
+
+//it is the deepest number of turns planNextTurns will search
+const int MAX_PLAN_DEPTH = 8;
 
-        if (avoided > 3) return 0.1; //it assumes they probably dont have this color
-        if (played > 3) return 0.8;  //it assumes they probably have this color
+//it is a sequence of hand indices stored inline so a plan never touches the heap
+//it holds at most MAX_PLAN_DEPTH cards
+struct PlanSequence {
+    int indices[MAX_PLAN_DEPTH];
+    int length = 0;
 
-        return 0.25 + (played - avoided) * 0.1; //it adjusts based on behavior
+    void push_back(int index) {
+        assert(length < MAX_PLAN_DEPTH && "a PlanSequence holds at most MAX_PLAN_DEPTH cards");
+        indices[length++] = index;
     }
+    void pop_back() { length--; }
+    void clear() { length = 0; }
+    bool empty() const { return length == 0; }
+    int size() const { return length; }
+    int operator[](int i) const { return indices[i]; }
+    const int* begin() const { return indices; }
+    const int* end() const { return indices + length; }
 };
 
 //it is the multi-turn plan structure
 struct TurnPlan {
-    std::vector<int> cardSequence;  //it stores indices of cards to play in order
+    PlanSequence cardSequence;       //it stores indices of cards to play in order
     double expectedUtility;          //it stores the expected value of this plan
     int expectedHandSize;            //it stores expected hand size after plan
 };
 
+//it is the budget of an anytime plan search, where 0 turns a limit off
+struct PlanBudget {
+    double timeBudgetUs = 0.0;     //it is the wall-clock budget in microseconds
+    long long nodeBudget = 0;      //it is the most search nodes over every depth, which unlike time gives the same plan every run
+    int maxDepth = MAX_PLAN_DEPTH; //it is the deepest number of turns to try
+};
+
+//it is the result of an anytime plan search
+struct AnytimePlan {
+    TurnPlan plan;        //it is the plan of the deepest search that finished
+    int depthReached;     //it is the depth of that search
+    long long nodes;      //it is how many nodes every depth searched together, counting the one that was cut short
+    bool complete;        //it is true if it reached the deepest useful depth before the budget ran out
+};
+
+//it is the GLPK problem type which is only forward declared so glpk.h stays out of this header
+struct glp_prob;
+
+//it is an extra linear constraint on the selection variables: lower <= sum(coefficients[i] * x[i]) <= upper
+struct LPConstraint {
+    std::vector<double> coefficients; //it has one coefficient per selection variable
+    double lower;
+    double upper;
+};
+
+//it is a GLPK problem that is kept alive and resized between decisions instead of being rebuilt every move
+class LPSolverContext {
+private:
+    glp_prob* lp;                //it is the persistent problem
+    int numCols;                 //it is how many columns the problem currently has
+    int numExtraRows;            //it is how many rows were added after the pick-one row
+    std::vector<int> indices;    //it is the reusable 1-indexed index buffer for GLPK
+    std::vector<double> values;  //it is the reusable 1-indexed value buffer for GLPK
+
+    //it resizes the problem to the number of selection variables
+    void resize(int cols);
+
+public:
+    LPSolverContext();
+    ~LPSolverContext();
+    LPSolverContext(const LPSolverContext&) = delete;
+    LPSolverContext& operator=(const LPSolverContext&) = delete;
+
+    //it gets the context that belongs to the calling thread
+    static LPSolverContext& forThisThread();
+
+    //it picks exactly one variable with the highest utility that satisfies the extra constraints
+    //it returns the index of the picked variable or -1 if there is no feasible pick
+    //it only runs the GLPK MIP when there are extra constraints, otherwise it is a closed-form argmax
+    int solvePickOne(const std::vector<double>& utilities,
+                     const std::vector<LPConstraint>& extraConstraints = {});
+};
+
 //it is the linear programming optimizer
 class LPOptimizer {
 public:
@@ -114,23 +404,33 @@ public:
 
     //it solves LP with multi-turn planning
     static int solveLPMultiTurn(const std::vector<Card>& hand, const Card& topCard,
-                                int handSize, int opponentHandSize,
-                                const OpponentModel& opponentModel, int turnsAhead);
+                                int handSize, const SeatView& seats, int turnsAhead);
 
     //it creates a multi-turn plan for the next N turns
     static TurnPlan planNextTurns(const std::vector<Card>& hand, const Card& topCard,
-                                   int opponentHandSize, const OpponentModel& opponentModel,
-                                   int numTurns);
+                                   const SeatView& seats, int numTurns);
+
+    //it deepens planNextTurns one turn at a time until the budget runs out and keeps the deepest plan that finished
+    static AnytimePlan planAnytime(const std::vector<Card>& hand, const Card& topCard,
+                                   const SeatView& seats, const PlanBudget& budget);
 
     //it calculates expected utility of a card sequence
     static double evaluateSequence(const std::vector<Card>& hand,
                                     const std::vector<int>& sequence,
-                                    const Card& topCard, int opponentHandSize,
-                                    const OpponentModel& opponentModel);
+                                    const Card& topCard, const SeatView& seats);
 
     //it gets the versatility score of a card (how many situations it can be played in)
     static double getCardVersatility(const Card& card, const std::vector<Card>& hand);
 
+    //it gets the versatility score of a card from the hand counts without scanning the hand
+    static double getCardVersatility(const Card& card, const HandCounts& counts);
+
+    //it calculates expected utility of a card sequence using hand counts that were already built
+    //it does not allocate so it can run inside the search hot path
+    static double evaluateSequence(const std::vector<Card>& hand, const HandCounts& counts,
+                                    const int* sequence, int length,
+                                    const Card& topCard, const SeatView& seats);
+
     //it calculates opponent blocking probability
     static double getBlockingProbability(const Card& cardToPlay, const OpponentModel& model);
 
@@ -140,13 +440,49 @@ public:
     static double calcDefendingValue(const Card& card, int opponentHandSize);
 };
 
+//it is the multi-turn MIP planner which orders several cards with binary x[card][turn] variables
+//it keeps its GLPK problem and its last plan between turns so the next turn can be warm-started
+class MIPPlanner {
+private:
+    glp_prob* lp;                        //it is the persistent problem that is refilled every turn
+    std::vector<int> rowIndices;         //it is the reusable 1-indexed row index buffer for glp_load_matrix
+    std::vector<int> colIndices;         //it is the reusable 1-indexed column index buffer for glp_load_matrix
+    std::vector<double> matrixValues;    //it is the reusable 1-indexed value buffer for glp_load_matrix
+    std::vector<Card> lastPlanCards[MAX_SEATS]; //it is the cards of the last plan of each seat, used to warm-start its next turn
+
+public:
+    double timeBudgetUs; //it is the most time one plan is allowed to take in microseconds, counting the fallback plan
+
+    explicit MIPPlanner(double budgetUs = 1000.0);
+    ~MIPPlanner();
+    MIPPlanner(const MIPPlanner&) = delete;
+    MIPPlanner& operator=(const MIPPlanner&) = delete;
+
+    //it gets the planner that belongs to the calling thread
+    static MIPPlanner& forThisThread();
+
+    //it plans the order to play up to numTurns cards
+    //each turn plays one card that must match the card before it, and every card is used at most once
+    //it scores every turn in the current direction, since a reverse played in the plan is not a linear term
+    //it falls back to planNextTurns when the solver finds no plan within the time budget
+    //seat picks which last plan warm-starts this one, since the seats of a self-play game share one thread
+    TurnPlan plan(const std::vector<Card>& hand, const Card& topCard,
+                  const SeatView& seats, int numTurns, int seat = 0);
+
+    //it forgets the last plans so the next turn of every seat is solved cold
+    void reset() { for (auto& cards : lastPlanCards) cards.clear(); }
+};
+
 //it is the player class
 class Player {
 private:
     std::vector<Card> hand;
+    HandCounts handCounts; //it mirrors the hand as counts for fast checks
     bool isAI;
     std::string name;
-    OpponentModel opponentModel; //it tracks opponent behavior
+    int strategyId; //it is the StrategyRegistry id of the AI strategy, -1 for the default planner
+    bool handSorted; //it is true while the hand is in sortHand order so addCard can insert in place
+    TableModel tableModel; //it tracks the behavior of every other seat
 
 public:
     Player(bool ai = false, const std::string& playerName = "Player");
@@ -163,10 +499,16 @@ public:
     //it chooses the optimal card with advanced LP and opponent modeling
     int chooseOptimalCardAdvanced(const Card& topCard, int opponentHandSize, int turnsAhead) const;
 
+    //it chooses the optimal card with the multi-turn MIP planner within a time budget
+    int chooseOptimalCardMIP(const Card& topCard, int opponentHandSize, int turnsAhead, double timeBudgetUs) const;
+
+    //it chooses the optimal card with the sequence planner searched as deep as the budget allows
+    int chooseOptimalCardAnytime(const Card& topCard, int opponentHandSize, const PlanBudget& budget) const;
+
     //it plays a card and returns it
     Card playCard(int index);
 
-    //it adds a card to the hand
+    //it adds a card to the hand, inserting it in order when the hand is already sorted
     void addCard(const Card& card);
 
     //it returns the hand size
@@ -175,10 +517,16 @@ public:
     //it returns the hand
     const std::vector<Card>& getHand() const;
 
+    //it returns the hand as counts per distinct card
+    const HandCounts& getHandCounts() const { return handCounts; }
+
+    //it replaces the whole hand, which search AIs use to give opponents a sampled hand
+    void setHand(const std::vector<Card>& newHand);
+
     //it chooses the best color for a wild card
     cardColor chooseBestColor(const Card& topCard) const;
 
-    //it sorts the hand using radix sort
+    //it sorts the hand by color and then type with a counting sort, and does nothing if it is already sorted
     void sortHand();
 
     //it checks if this is an AI player
@@ -187,30 +535,139 @@ public:
     //it gets the player name
     std::string getName() const { return name; }
 
-    //it updates the opponent model based on observed play
-    void updateOpponentModel(const Card& playedCard, bool opponentDrew);
+    //it sets the AI strategy by StrategyRegistry id
+    void setStrategy(int id) { strategyId = id; }
+
+    //it gets the StrategyRegistry id of the AI strategy
+    int getStrategy() const { return strategyId; }
+
+    //it updates the model of one seat based on observed play
+    //for a draw, the card is the top card they could not play on and cardsDrawn is how many they took
+    //unseenColorCounts is the color count of the cards outside the discard pile and the top card,
+    //or nullptr to keep drawing from the shares it had, which the infinite deck uses
+    void updateOpponentModel(int seat, const Card& playedCard, bool opponentDrew, int newHandSize,
+                             int cardsDrawn = 1, const int* unseenColorCounts = nullptr);
 
-    //it gets the opponent model for analysis
-    const OpponentModel& getOpponentModel() const { return opponentModel; }
+    //it gets the model of the seat that plays after this player, which is the one that answers its card
+    const OpponentModel& getOpponentModel() const { return tableModel.getModel(tableModel.nextSeat); }
+
+    //it gets the model of every seat
+    const TableModel& getTableModel() const { return tableModel; }
+
+    //it starts a fresh table model when a game starts
+    void resetTableModel(int numSeats, int seat) { tableModel.reset(numSeats, seat); }
+
+    //it tells the table model which seat plays after this player, which changes with a reverse
+    void setNextSeat(int seat) { tableModel.nextSeat = seat; }
+};
+
+//it turns a state into a well mixed 64-bit number and moves the state on, which is used to seed and hash
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//it is the xoshiro256** random number generator used for shuffling, drawing and search
+//it has 32 bytes of state so copying a Deck or a Game is cheap, unlike the 5 KB of std::mt19937
+//it can be used with the std algorithms, but the deck uses below() so the results are the same on every compiler
+class FastRng {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    using result_type = uint64_t;
+
+    //it seeds the state by running the seed through splitMix64 so close seeds give unrelated streams
+    explicit FastRng(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed) {
+        uint64_t state = seed;
+        for (auto& word : s) word = splitMix64(state);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~0ULL; }
+
+    //it gets the next 64 random bits
+    result_type operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    //it gets a number in [0, bound) without modulo bias using Lemire's multiply and reject method
+    uint32_t below(uint32_t bound) {
+        uint64_t m = (uint64_t)(uint32_t)((*this)() >> 32) * bound;
+        uint32_t low = (uint32_t)m;
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                m = (uint64_t)(uint32_t)((*this)() >> 32) * bound;
+                low = (uint32_t)m;
+            }
+        }
+        return (uint32_t)(m >> 32);
+    }
+
+    //it gets a double in [0, 1) from the top 53 bits
+    double nextDouble() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+    //it moves the state 2^128 steps ahead so a copy before the jump and the state after it never overlap
+    void jump();
+
+    //it gets an independent generator for a parallel stream and moves this one past it
+    FastRng split() {
+        FastRng child = *this;
+        jump();
+        return child;
+    }
 };
 
 //it is the deck class
 class Deck {
 private:
-    std::vector<Card> cards;
-    std::mt19937 rng;
+    std::vector<Card> cards;  //it is the pile with the next card to draw at the back
+    int colorCounts[5];       //it counts the cards of each color in the pile, with played wilds counted as WILDS
+    FastRng rng;
+    bool infinite;            //it makes draw return random cards forever instead of using the pile
 
 public:
     Deck();
 
+    //it creates a deck with a fixed seed so the shuffles can be reproduced
+    explicit Deck(unsigned int seed);
+
+    //it creates a deck that uses a generator which was already seeded or split off another one
+    explicit Deck(const FastRng& rng);
+
     //it initializes a full UNO deck
     void initinialize();
 
     //it shuffles the deck
     void shuffle();
 
-    //it draws a card from the deck
-    Card draw();
+    //it draws the card at the back of the pile in O(1), or makes a random card in infinite mode
+    //it returns false and leaves card alone when a finite pile is empty
+    bool draw(Card& card);
+
+    //it moves every card of another pile into this one, turns the wilds back to WILDS and shuffles
+    void recycleFrom(Deck& other);
+
+    //it turns the infinite deck mode on or off
+    void setInfinite(bool on) { infinite = on; }
+
+    //it checks if the deck is in infinite mode
+    bool isInfinite() const { return infinite; }
 
     //it checks if the deck is empty
     bool isEmpty() const;
@@ -220,6 +677,100 @@ public:
 
     //it adds a card to the deck
     void addCard(const Card& card);
+
+    //it replaces the pile with these cards and shuffles them
+    void setCards(const std::vector<Card>& newCards);
+
+    //it reseeds the random number generator
+    void reseed(unsigned int seed);
+
+    //it replaces the random number generator with one that was seeded or split elsewhere
+    void reseed(const FastRng& generator) { rng = generator; }
+
+    //it gets the cards with the next one to draw at the back
+    const std::vector<Card>& getCards() const { return cards; }
+
+    //it gets how many cards of a color are in the pile, counting every wild as WILDS
+    int getColorCount(cardColor color) const { return colorCounts[color]; }
+
+    //it gets the random number generator so its state can be saved
+    const FastRng& getRng() const { return rng; }
+};
+
+//it is how many cards a full UNO deck has
+const int DECK_SIZE = 108;
+
+//it is the most seats a GameSnapshot can hold
+const int MAX_SNAPSHOT_PLAYERS = MAX_SEATS;
+
+//it is the snapshot move that draws instead of playing, every other move is the HandCounts slot of the card played
+const int SNAPSHOT_DRAW_MOVE = HAND_SLOTS;
+
+//it is what GameSnapshot::undo needs to take one move back
+struct SnapshotUndo {
+    FastRng rng;             //it is the generator before the move
+    Card topCard;            //it is the top card before the move
+    int currentPlayer;
+    int drawStack;
+    int pileSize;            //it is the draw pile size before the move
+    int drawer;              //it is the seat that drew the cards
+    int playedSlot;          //it is the slot that was played or -1 for a draw
+    GameState state;
+    int winner;
+    bool clockwise;
+    bool reshuffled;         //it is set when the discard pile was shuffled into the draw pile
+    uint8_t drawnCount;
+    uint8_t drawn[DECK_SIZE];  //it is the packed cards that were drawn in order, only drawnCount are written
+};
+
+//it is the whole state of a game in flat arrays so it can be copied with memcpy
+//the search AIs apply and undo millions of moves on it instead of copying Game with its vectors and maps
+//it follows the rules of Game::playTurn, except every seat picks the color of a wild right away like the AI does,
+//and it leaves out the opponent models, which only the players update
+struct GameSnapshot {
+    HandCounts hands[MAX_SNAPSHOT_PLAYERS];
+    uint8_t pile[DECK_SIZE];        //it is the packed draw pile with the next card at pileSize - 1
+    uint8_t discard[HAND_SLOTS];    //it counts the discarded cards, the order does not matter since they get shuffled
+    FastRng rng;                    //it is the draw pile generator used for reshuffles and infinite draws
+    Card topCard;
+    int numPlayers;
+    int currentPlayer;
+    int drawStack;
+    int pileSize;
+    int discardSize;
+    int winner;
+    GameState state;
+    bool clockwise;
+    bool infinite;                  //it draws random cards like Deck in infinite mode
+
+    //it plays a move for the current player and fills undo so it can be taken back
+    //wildColor is the color for a wild, and WILDS picks it the way the AI does
+    //it returns false and changes nothing if the move is not allowed
+    bool apply(int move, SnapshotUndo& undo, cardColor wildColor = WILDS);
+
+    //it takes back the move that filled undo, which has to be the last move applied
+    void undo(const SnapshotUndo& undo);
+
+    //it lists every move Game::playTurn would accept, playable slots first and then the draw
+    //it returns how many were written to moves, which needs room for HAND_SLOTS + 1 entries
+    int legalMoves(int* moves) const;
+
+private:
+    //it draws up to count cards for a seat and records them in undo
+    void drawCards(int seat, int count, SnapshotUndo& undo);
+};
+static_assert(std::is_trivially_copyable_v<GameSnapshot>, "GameSnapshot has to stay copyable with memcpy");
+
+class GameRecordWriter;
+
+//it is the link from a Game to the writer that records its moves
+//copies of a game do not take the link with them, so the games the search AIs play ahead are never recorded
+struct RecorderLink {
+    GameRecordWriter* writer = nullptr;
+
+    RecorderLink() = default;
+    RecorderLink(const RecorderLink&) {}
+    RecorderLink& operator=(const RecorderLink&) { return *this; }
 };
 
 //it is the game class
@@ -235,6 +786,15 @@ private:
     GameState state;
     int winner;
     Card lastPlayedCard; //it tracks the last played card for opponent modeling
+    bool infiniteDeck;   //it deals random cards forever instead of using the 108-card deck
+    RecorderLink recorder;
+
+    //it tells every other AI player what a seat just played or drew
+    void observeMove(int seat, const Card& card, bool drew, int cardsDrawn, const int* unseenColorCounts);
+
+    //it draws one card, reshuffling the discard pile into the deck when it runs out
+    //it returns false if every card is in a hand so there is nothing left to draw
+    bool drawFromDeck(Card& card);
 
 public:
     Game();
@@ -242,6 +802,9 @@ public:
     //it initializes a new game
     void initialize(int numPlayers, int numAI);
 
+    //it initializes a new game with a fixed seed so the game can be reproduced
+    void initialize(int numPlayers, int numAI, unsigned int seed);
+
     //it plays a turn
     void playTurn(int cardIndex);
 
@@ -263,9 +826,37 @@ public:
     //it handles wild card color selection
     void chooseColorForWild(cardColor color);
 
+    //it reseeds and reshuffles the draw pile so a copied game draws different cards than the original
+    void reseed(unsigned int seed);
+
+    //it replaces the draw pile with these cards in a shuffled order, which search AIs use for a sampled world
+    void setDrawPile(const std::vector<Card>& cards) { deck.setCards(cards); }
+
+    //it counts the cards in the draw pile, the discard pile, every hand and the top card
+    //it is DECK_SIZE all game long unless the deck is infinite
+    int countCards() const;
+
+    //it saves the state into a snapshot and returns false if there are more than MAX_SNAPSHOT_PLAYERS seats
+    bool saveSnapshot(GameSnapshot& snapshot) const;
+
+    //it loads a snapshot of a game with the same seats back, leaving names, AI flags and opponent models alone
+    void restoreSnapshot(const GameSnapshot& snapshot);
+
+    //it gets the seat that plays after another one
+    static int seatAfter(int seat, bool clockwise, int numPlayers) {
+        return clockwise ? (seat + 1) % numPlayers : (seat - 1 + numPlayers) % numPlayers;
+    }
+
+    //it switches between the real 108-card deck and the old infinite random deck for the next initialize
+    void setInfiniteDeck(bool on) { infiniteDeck = on; }
+
+    //it records every game started after this into the writer, or stops recording for nullptr
+    void setRecorder(GameRecordWriter* writer) { recorder.writer = writer; }
+
     //getters
     const std::vector<Player>& getPlayers() const { return players; }
     const Player& getCurrentPlayer() const { return players[currentPlayer]; }
+    Player& getPlayer(int index) { return players[index]; }
     Player& getCurrentPlayer() { return players[currentPlayer]; }
     int getCurrentPlayerIndex() const { return currentPlayer; }
     const Card& getTopCard() const { return topCard; }
@@ -273,6 +864,11 @@ public:
     int getWinner() const { return winner; }
     int getDrawStack() const { return drawStack; }
     bool isClockwise() const { return clockwise; }
+    int getDeckSize() const { return deck.size(); }
+    const Deck& getDeck() const { return deck; }
+    const Deck& getDiscardPile() const { return discardPile; }
+    bool isInfiniteDeck() const { return deck.isInfinite(); }
+    int getDiscardSize() const { return discardPile.size(); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include "endgame.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include "instrument.h"
+
+using namespace std;
+
+//it is the deepest the solver goes no matter what the config asks for
+const int ENDGAME_MAX_DEPTH = 16;
+
+//it is the biggest opponent hand the hold chances are worked out for, bigger hands use this one
+const int ENDGAME_MAX_OPPONENT = 40;
+
+const int ENDGAME_TABLE_SIZE = 1 << 15;
+
+//they are the weights of the guess at the chance of winning where the search stops, which is
+//1 / (1 + e^-z) with z the sum of the weights times the features below
+//they were fitted with a logistic regression on 1.7 million positions of 30000 two-player games of the
+//planner against itself, counting every position with at most 8 cards in both hands from both sides
+const double LEAF_BIAS = 0.017;
+const double LEAF_OPPONENT_CARDS = 0.655; //it is per log of the opponent hand size
+const double LEAF_OWN_CARDS = 0.990;      //it is per log of the own hand size
+const double LEAF_TO_MOVE = 0.203;
+const double LEAF_WILD = 0.798;           //it is per wild or wild draw four held
+const double LEAF_SKIP = 0.151;           //it is per skip or reverse held
+const double LEAF_DRAW_TWO = 0.390;       //it is per draw two held
+
+//it is the natural log of a hand size, looked up since every leaf needs two of them
+static double logOf(int handSize) {
+    static const struct LogTable {
+        double values[DECK_SIZE + 1];
+        LogTable() {
+            values[0] = 0.0;
+            for (int n = 1; n <= DECK_SIZE; n++) values[n] = log((double)n);
+        }
+    } table;
+    return table.values[min(max(handSize, 0), DECK_SIZE)];
+}
+
+//it is the mask of the two draw cards that may be played onto a draw stack
+static constexpr uint64_t DRAW_CARDS_MASK = HandCounts::typeMask(DRAW_TWO) | HandCounts::typeMask(WILD_DRAW_FOUR);
+
+//it is the mask of the cards that are tried first since they keep the turn or hurt the opponent
+static constexpr uint64_t ACTION_CARDS_MASK = HandCounts::typeMask(SKIP) | HandCounts::typeMask(REVERSE) | DRAW_CARDS_MASK;
+
+//it is how many copies of each slot are in a full deck
+static int copiesInDeck(int slot) {
+    Card card = HandCounts::cardOf(slot);
+    if (card.isWild()) return 4;
+    return card.type == ZERO ? 1 : 2;
+}
+
+//it is how many cards a draw card adds to the draw stack
+static int stackAdded(cardValue type) {
+    if (type == DRAW_TWO) return 2;
+    if (type == WILD_DRAW_FOUR) return 4;
+    return 0;
+}
+
+//it is the random keys the endgame positions are hashed with
+struct EndgameHashKeys {
+    uint64_t slotKeys[HAND_SLOTS];
+    uint64_t topKeys[256];
+    uint64_t opponentKeys[128];
+    uint64_t stackKeys[64];
+    uint64_t depthKeys[ENDGAME_MAX_DEPTH + 1];
+    uint64_t ourTurnKey;
+    uint64_t drewKey;
+
+    EndgameHashKeys() {
+        uint64_t state = 0xE9D6A3E5011FULL;
+        for (auto& key : slotKeys) key = splitMix64(state);
+        for (auto& key : topKeys) key = splitMix64(state);
+        for (auto& key : opponentKeys) key = splitMix64(state);
+        for (auto& key : stackKeys) key = splitMix64(state);
+        for (auto& key : depthKeys) key = splitMix64(state);
+        ourTurnKey = splitMix64(state);
+        drewKey = splitMix64(state);
+    }
+};
+static const EndgameHashKeys endgameHashKeys;
+
+//it is what a table entry says about its value, which depends on the window it was searched with
+enum EndgameBound : uint8_t {
+    ENDGAME_EXACT,
+    ENDGAME_LOWER,  //it is at least the value, the search failed high
+    ENDGAME_UPPER   //it is at most the value, the search failed low
+};
+
+//it is one entry of the transposition table of the endgame search
+struct EndgameTableEntry {
+    uint64_t key;
+    uint32_t generation;  //it is the solve that wrote the entry so old entries never need clearing
+    EndgameBound bound;
+    double value;
+};
+
+//it is the running sum of a chance node, which gives each outcome the window that still matters (Star1)
+//every value is a chance of winning between 0 and 1, so the outcomes not searched yet are bounded by those
+struct ChanceWindow {
+    double alpha;
+    double beta;
+    double sum = 0.0;     //it is the weighted value of the outcomes searched so far
+    double weight = 0.0;  //it is the probability of the outcomes searched so far
+
+    ChanceWindow(double a, double b) : alpha(a), beta(b) {}
+
+    //it is the window of an outcome with probability p, from the best and worst the rest could still give
+    double childAlpha(double p) const { return (alpha - sum - (1.0 - weight - p)) / p; }
+    double childBeta(double p) const { return (beta - sum) / p; }
+
+    void add(double p, double value) {
+        sum += p * value;
+        weight += p;
+    }
+
+    //it is true when even winning every outcome left can not lift the node above alpha
+    bool failsLow() const { return sum + (1.0 - weight) <= alpha; }
+
+    //it is true when losing every outcome left still keeps the node at beta or more
+    bool failsHigh() const { return sum >= beta; }
+
+    //it is the value to return after a cut, which is a bound on the right side of the window
+    double cutValue() const { return failsLow() ? sum + (1.0 - weight) : sum; }
+};
+
+//it is one outcome of an opponent turn
+struct OpponentOutcome {
+    double probability;
+    int slot;        //it is the card they play or -1 when they do not play
+    int handChange;  //it is how their hand size changes before the card lands
+};
+
+//it is the expectimax search behind EndgameSolver::solve
+struct EndgameSearch {
+    double drawChance[HAND_SLOTS];   //it is the chance a drawn card is in each slot
+    double colorScale[5];            //it is how much more or less likely the model makes each color than a random hand
+    double holdChance[ENDGAME_MAX_OPPONENT + 1][HAND_SLOTS];
+    bool holdReady[ENDGAME_MAX_OPPONENT + 1];
+    cardColor opponentWildColor;     //it is the color the opponent is thought to pick for a wild
+    EndgameTableEntry* table;
+    uint32_t generation;
+
+    long long nodes;
+    long long nodeLimit;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+    bool aborted;
+
+    EndgameSearch(const HandCounts& hand, const Card& topCard, int opponentHandSize, const OpponentModel& opponentModel,
+                  const HandCounts* discarded)
+        : nodes(0), nodeLimit(0), hasDeadline(false), aborted(false) {
+        //it counts the cards this player has not seen, which are the ones the opponent holds or anyone draws
+        //it leaves out the discard pile the same way Game::playTurn does for the opponent models
+        int unseen[HAND_SLOTS];
+        int unseenColors[5] = { 0, 0, 0, 0, 0 };
+        int unseenTotal = 0;
+        int topSlot = HandCounts::slotOf(topCard);
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            int seen = hand.counts[s] + (s == topSlot ? 1 : 0) + (discarded ? discarded->counts[s] : 0);
+            unseen[s] = max(0, copiesInDeck(s) - seen);
+            unseenColors[HandCounts::cardOf(s).color] += unseen[s];
+            unseenTotal += unseen[s];
+        }
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            drawChance[s] = unseenTotal > 0 ? unseen[s] / (double)unseenTotal : 0.0;
+        }
+
+        //it compares the chance the model gives each color with the chance a random hand of that size has it
+        for (int c = 0; c <= WILDS; c++) {
+            double share = unseenTotal > 0 ? unseenColors[c] / (double)unseenTotal : 0.0;
+            double prior = 1.0 - pow(1.0 - share, opponentHandSize);
+            colorScale[c] = prior > 0.0 ? opponentModel.getProbabilityHasColor(static_cast<cardColor>(c)) / prior : 0.0;
+        }
+        fill(begin(holdReady), end(holdReady), false);
+
+        opponentWildColor = REDS;
+        for (int c = BLUES; c <= YELLOWS; c++) {
+            if (opponentModel.getProbabilityHasColor(static_cast<cardColor>(c)) >
+                opponentModel.getProbabilityHasColor(opponentWildColor)) {
+                opponentWildColor = static_cast<cardColor>(c);
+            }
+        }
+
+        //it reuses one table per thread and invalidates the old entries by moving to a new generation
+        static thread_local std::vector<EndgameTableEntry> sharedTable(ENDGAME_TABLE_SIZE,
+                                                                      EndgameTableEntry{0, 0, ENDGAME_EXACT, 0.0});
+        static thread_local uint32_t sharedGeneration = 0;
+        if (++sharedGeneration == 0) {
+            std::fill(sharedTable.begin(), sharedTable.end(), EndgameTableEntry{0, 0, ENDGAME_EXACT, 0.0});
+            sharedGeneration = 1;
+        }
+        table = sharedTable.data();
+        generation = sharedGeneration;
+    }
+
+    //it gets the chance an opponent with this many cards holds at least one card of each slot
+    const double* holdChances(int opponentHandSize) {
+        int size = min(opponentHandSize, ENDGAME_MAX_OPPONENT);
+        if (!holdReady[size]) {
+            for (int s = 0; s < HAND_SLOTS; s++) {
+                double chance = 1.0 - pow(1.0 - drawChance[s], size);
+                holdChance[size][s] = min(1.0, chance * colorScale[HandCounts::cardOf(s).color]);
+            }
+            holdReady[size] = true;
+        }
+        return holdChance[size];
+    }
+
+    //it counts a node and checks the budget, reading the clock only every 64 nodes
+    bool outOfBudget() {
+        nodes++;
+        if (nodeLimit > 0 && nodes > nodeLimit) {
+            aborted = true;
+        }
+        else if (hasDeadline && (nodes & 63) == 0 && std::chrono::steady_clock::now() >= deadline) {
+            aborted = true;
+        }
+        return aborted;
+    }
+
+    //it guesses the chance of winning once the depth runs out from the hand sizes and the cards that win races
+    //handSize can be more than the hand when it has just taken a draw stack whose cards are not known
+    static double leafValue(const HandCounts& hand, int handSize, int opponentHandSize, bool ourMove) {
+        double z = LEAF_BIAS
+            + LEAF_OPPONENT_CARDS * logOf(opponentHandSize)
+            - LEAF_OWN_CARDS * logOf(handSize)
+            + (ourMove ? LEAF_TO_MOVE : 0.0)
+            + LEAF_WILD * (hand.typeCounts[WILD] + hand.typeCounts[WILD_DRAW_FOUR])
+            + LEAF_SKIP * (hand.typeCounts[SKIP] + hand.typeCounts[REVERSE])
+            + LEAF_DRAW_TWO * hand.typeCounts[DRAW_TWO];
+        return 1.0 / (1.0 + exp(-z));
+    }
+
+    //it returns the chance of winning of a position, searched depth turns deep inside the window (alpha, beta)
+    //drew is true when the AI already drew a card it can play this turn, so it has to play a card now
+    double value(const HandCounts& hand, uint64_t handKey, int opponentHandSize, const Card& topCard,
+                 int drawStack, bool ourMove, bool drew, int depth, double alpha, double beta) {
+        if (aborted || outOfBudget() || depth <= 0) return leafValue(hand, hand.total, opponentHandSize, ourMove);
+
+        uint64_t key = handKey ^ endgameHashKeys.topKeys[topCard.pack()]
+                     ^ endgameHashKeys.opponentKeys[min(opponentHandSize, 127)]
+                     ^ endgameHashKeys.stackKeys[min(drawStack, 63)]
+                     ^ endgameHashKeys.depthKeys[depth]
+                     ^ (ourMove ? endgameHashKeys.ourTurnKey : 0)
+                     ^ (drew ? endgameHashKeys.drewKey : 0);
+        EndgameTableEntry& cached = table[key & (ENDGAME_TABLE_SIZE - 1)];
+        if (cached.generation == generation && cached.key == key) {
+            if (cached.bound == ENDGAME_EXACT
+                || (cached.bound == ENDGAME_LOWER && cached.value >= beta)
+                || (cached.bound == ENDGAME_UPPER && cached.value <= alpha)) {
+                return cached.value;
+            }
+        }
+
+        double result = ourMove
+            ? ourTurn(hand, handKey, opponentHandSize, topCard, drawStack, drew, depth, alpha, beta)
+            : opponentTurn(hand, handKey, opponentHandSize, topCard, drawStack, depth, alpha, beta);
+
+        //it does not keep a value that was cut short by the budget
+        if (aborted) return result;
+
+        EndgameBound bound = result <= alpha ? ENDGAME_UPPER : (result >= beta ? ENDGAME_LOWER : ENDGAME_EXACT);
+        table[key & (ENDGAME_TABLE_SIZE - 1)] = EndgameTableEntry{key, generation, bound, result};
+        return result;
+    }
+
+    //it gets the slots the AI may play, which are only the draw cards while a draw stack is waiting
+    static uint64_t legalSlots(const HandCounts& hand, const Card& topCard, int drawStack) {
+        uint64_t mask = hand.playable(topCard);
+        return drawStack > 0 ? mask & DRAW_CARDS_MASK : mask;
+    }
+
+    //it plays one slot of the AI hand the way Game::playTurn does and returns the chance of winning after it
+    double playSlot(const HandCounts& hand, uint64_t handKey, int slot, int opponentHandSize,
+                    int drawStack, int depth, double alpha, double beta) {
+        Card card = HandCounts::cardOf(slot);
+        HandCounts next = hand;
+        next.remove(card);
+        if (next.total == 0) return 1.0;
+
+        //it takes the color the AI picks for a wild, which is the color it holds most of after the wild is gone
+        if (card.isWild()) card.colorChange(next.bestColor());
+        bool playsAgain = card.type == SKIP || card.type == REVERSE;
+        return value(next, handKey - endgameHashKeys.slotKeys[slot], opponentHandSize, card,
+                     drawStack + stackAdded(card.type), playsAgain, false, depth - 1, alpha, beta);
+    }
+
+    //it draws for the AI, which keeps the turn when the drawn card can be played
+    //the card played after such a draw belongs to the same turn, so the depth only goes down when the turn passes
+    double drawCard(const HandCounts& hand, uint64_t handKey, int opponentHandSize, const Card& topCard,
+                    int drawStack, int depth, double alpha, double beta) {
+        //it does not split a whole draw stack into every set of cards, since the hand is no longer short after it
+        if (drawStack > 0) return leafValue(hand, hand.total + drawStack, opponentHandSize, false);
+
+        uint64_t playable = HandCounts::playableMask(topCard);
+        ChanceWindow window(alpha, beta);
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            double p = drawChance[s];
+            if (p <= 0.0) continue;
+
+            HandCounts next = hand;
+            next.add(HandCounts::cardOf(s));
+            bool keepsTurn = (playable >> s) & 1;
+            double v = value(next, handKey + endgameHashKeys.slotKeys[s], opponentHandSize, topCard, 0, keepsTurn,
+                             keepsTurn, keepsTurn ? depth : depth - 1, window.childAlpha(p), window.childBeta(p));
+            window.add(p, v);
+            if (window.failsLow() || window.failsHigh()) return window.cutValue();
+        }
+        return window.sum;
+    }
+
+    //it is the AI to move, which takes the best of its moves
+    //it does not draw a second time in one turn, which Game allows but which would let a turn go on forever
+    double ourTurn(const HandCounts& hand, uint64_t handKey, int opponentHandSize, const Card& topCard,
+                   int drawStack, bool drew, int depth, double alpha, double beta) {
+        uint64_t moves = legalSlots(hand, topCard, drawStack);
+        double best = 0.0;
+
+        //it tries the action cards first since they most often decide an endgame
+        for (uint64_t group : { moves & ACTION_CARDS_MASK, moves & ~ACTION_CARDS_MASK }) {
+            while (group) {
+                int slot = countr_zero(group);
+                group &= group - 1;
+                double v = playSlot(hand, handKey, slot, opponentHandSize, drawStack, depth, max(alpha, best), beta);
+                if (v > best) best = v;
+                if (best >= beta) return best;
+            }
+        }
+
+        if (drew) return best;
+        double v = drawCard(hand, handKey, opponentHandSize, topCard, drawStack, depth, max(alpha, best), beta);
+        return max(best, v);
+    }
+
+    //it lists what the opponent may do on a top card, which adds up to a probability of 1
+    //they play each card they might hold in proportion to the chance they hold it, and if they hold none
+    //they take the draw stack, or draw one card and play it when it fits
+    int opponentOutcomes(int opponentHandSize, const Card& topCard, int drawStack, OpponentOutcome* outcomes) {
+        uint64_t answers = HandCounts::playableMask(topCard);
+        if (drawStack > 0) answers &= DRAW_CARDS_MASK;
+
+        const double* hold = holdChances(opponentHandSize);
+        double holdsNone = 1.0;
+        double holdSum = 0.0;
+        for (uint64_t mask = answers; mask; mask &= mask - 1) {
+            int s = countr_zero(mask);
+            holdsNone *= 1.0 - hold[s];
+            holdSum += hold[s];
+        }
+
+        int count = 0;
+        if (holdSum > 0.0) {
+            for (uint64_t mask = answers; mask; mask &= mask - 1) {
+                int s = countr_zero(mask);
+                if (hold[s] > 0.0) outcomes[count++] = { (1.0 - holdsNone) * hold[s] / holdSum, s, -1 };
+            }
+        }
+        else {
+            holdsNone = 1.0;
+        }
+
+        if (drawStack > 0) {
+            outcomes[count++] = { holdsNone, -1, drawStack };
+        }
+        else {
+            double drawnFits = 0.0;
+            for (uint64_t mask = answers; mask; mask &= mask - 1) {
+                int s = countr_zero(mask);
+                if (drawChance[s] <= 0.0) continue;
+                outcomes[count++] = { holdsNone * drawChance[s], s, 0 };
+                drawnFits += drawChance[s];
+            }
+            outcomes[count++] = { holdsNone * max(0.0, 1.0 - drawnFits), -1, 1 };
+        }
+
+        //it searches the likely outcomes first so the window closes sooner
+        sort(outcomes, outcomes + count, [](const OpponentOutcome& a, const OpponentOutcome& b) {
+            return a.probability > b.probability;
+        });
+        return count;
+    }
+
+    //it is the opponent to move, which is a chance node over what they play or draw
+    double opponentTurn(const HandCounts& hand, uint64_t handKey, int opponentHandSize, const Card& topCard,
+                        int drawStack, int depth, double alpha, double beta) {
+        OpponentOutcome outcomes[2 * HAND_SLOTS + 1];
+        int count = opponentOutcomes(opponentHandSize, topCard, drawStack, outcomes);
+
+        ChanceWindow window(alpha, beta);
+        for (int o = 0; o < count; o++) {
+            const OpponentOutcome& outcome = outcomes[o];
+            double p = outcome.probability;
+            if (p <= 0.0) continue;
+
+            int newHandSize = opponentHandSize + outcome.handChange;
+            double v;
+            if (outcome.slot == -1) {
+                //it passes the turn back after a draw that did not fit or after taking the draw stack
+                v = value(hand, handKey, newHandSize, topCard, 0, true, false, depth - 1,
+                          window.childAlpha(p), window.childBeta(p));
+            }
+            else if (newHandSize == 0) {
+                v = 0.0;
+            }
+            else {
+                Card card = HandCounts::cardOf(outcome.slot);
+                if (card.isWild()) card.colorChange(opponentWildColor);
+                bool playsAgain = card.type == SKIP || card.type == REVERSE;
+                v = value(hand, handKey, newHandSize, card, drawStack + stackAdded(card.type), !playsAgain, false,
+                          depth - 1, window.childAlpha(p), window.childBeta(p));
+            }
+            window.add(p, v);
+            if (window.failsLow() || window.failsHigh()) return window.cutValue();
+        }
+        return window.sum;
+    }
+};
+
+//it runs the endgame search one depth deeper at a time until the budget runs out
+EndgameResult EndgameSolver::solve(const std::vector<Card>& hand, const Card& topCard, int drawStack,
+                                   int opponentHandSize, const OpponentModel& opponentModel,
+                                   const HandCounts* discarded, const EndgameConfig& config) {
+    UNO_TIME_SCOPE(PROBE_ENDGAME_SOLVE);
+    EndgameResult result = { -1, -1.0, 0, 0, true };
+
+    HandCounts counts(hand);
+    uint64_t moves = EndgameSearch::legalSlots(counts, topCard, drawStack);
+    if (moves == 0) return result; //it can only draw
+
+    EndgameSearch searcher(counts, topCard, opponentHandSize, opponentModel, discarded);
+    if (config.nodeBudget > 0) searcher.nodeLimit = config.nodeBudget;
+    if (config.timeBudgetUs > 0.0) {
+        searcher.hasDeadline = true;
+        searcher.deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double, std::micro>(config.timeBudgetUs));
+    }
+
+    uint64_t handKey = 0;
+    for (int s = 0; s < HAND_SLOTS; s++) handKey += endgameHashKeys.slotKeys[s] * counts.counts[s];
+
+    int bestSlot = -1;
+    int maxDepth = min(config.maxDepth, ENDGAME_MAX_DEPTH);
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        //it tries the best move of the last depth first so the others are searched with a tighter window
+        int order[HAND_SLOTS + 1];
+        int numMoves = 0;
+        if (bestSlot != -1) order[numMoves++] = bestSlot;
+        for (uint64_t mask = moves; mask; mask &= mask - 1) {
+            int slot = countr_zero(mask);
+            if (slot != bestSlot) order[numMoves++] = slot;
+        }
+        order[numMoves++] = SNAPSHOT_DRAW_MOVE;
+
+        double best = -1.0;
+        int depthBest = -1;
+        for (int m = 0; m < numMoves; m++) {
+            int move = order[m];
+            double v = move == SNAPSHOT_DRAW_MOVE
+                ? searcher.drawCard(counts, handKey, opponentHandSize, topCard, drawStack, depth, best, 2.0)
+                : searcher.playSlot(counts, handKey, move, opponentHandSize, drawStack, depth, best, 2.0);
+            if (searcher.aborted) break;
+            if (v > best) {
+                best = v;
+                depthBest = move;
+            }
+        }
+        if (searcher.aborted) break;
+
+        bestSlot = depthBest == SNAPSHOT_DRAW_MOVE ? -1 : depthBest;
+        result.winProbability = best;
+        result.depthReached = depth;
+
+        //it stops once a win is certain, since no deeper search can change that
+        if (best >= 1.0) break;
+    }
+    result.nodes = searcher.nodes;
+    UNO_COUNT(COUNTER_ENDGAME_NODES, searcher.nodes);
+
+    if (result.depthReached == 0) {
+        UNO_COUNT(COUNTER_ENDGAME_FALLBACKS, 1);
+        result.solved = false;
+        result.cardIndex = LPOptimizer::solveLPMultiTurn(hand, topCard, hand.size(),
+                                                         SeatView::headsUp(opponentHandSize, opponentModel),
+                                                         config.fallbackTurnsAhead);
+        return result;
+    }
+
+    if (bestSlot != -1) {
+        for (int i = 0; i < (int)hand.size(); i++) {
+            if (HandCounts::slotOf(hand[i]) == bestSlot) {
+                result.cardIndex = i;
+                break;
+            }
+        }
+    }
+    return result;
+}
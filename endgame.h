@@ -0,0 +1,53 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include <vector>
+#include "deck.h"
+
+//it is the settings of the endgame solver, where a budget of 0 turns that limit off
+struct EndgameConfig {
+    int handThreshold = 2;         //it takes over when the AI holds at most this many cards
+    int opponentThreshold = 2;     //it also takes over when the opponent holds at most this many cards
+    int maxDepth = 6;              //it is the deepest number of turns, where a draw and the card played after it are one turn
+    double timeBudgetUs = 1000.0;  //it is the wall-clock budget in microseconds
+    long long nodeBudget = 20000;  //it is the most nodes over every depth, which unlike time gives the same move every run
+    int fallbackTurnsAhead = 3;    //it is the turnsAhead solveLPMultiTurn is given when the budget runs out
+};
+
+//it is the result of an endgame search
+struct EndgameResult {
+    int cardIndex;         //it is the index in the hand to play or -1 to draw
+    double winProbability; //it is the chance of winning the deepest search gave the move, or -1 when it did not search
+    int depthReached;      //it is the depth of the deepest search that finished, 0 when it did not search
+    long long nodes;       //it is how many nodes every depth searched together
+    bool solved;           //it is false when the budget ran out before the first depth finished
+};
+
+//it is the exact endgame AI, which replaces the flat short-hand bonuses of getCardUtility once a hand is nearly empty
+//it runs expectimax over the chance of winning between the AI and the seat that plays after it:
+//  - the AI nodes take the best of every playable slot and the draw
+//  - a draw is a chance node over every slot of the cards the AI has not seen, weighted by how many are unseen
+//  - the opponent nodes are chance nodes over which card they play, from how likely the OpponentModel says they
+//    hold each playable card, and over what they draw when they can not play
+//the values are kept in a per-thread table keyed by a hash of the hand, the top card, the opponent hand size,
+//the draw stack, the side to move and the depth left, and the chance nodes are cut with Star1 bounds since a
+//chance of winning is always between 0 and 1
+//the table is played as if it only had the AI and the next seat, so a reverse gives the mover another turn
+//every depth is searched again one ply deeper until the budget runs out, and if not even the first depth
+//finishes the move comes from solveLPMultiTurn
+class EndgameSolver {
+public:
+    //it checks if the hands are small enough for the solver to take over
+    static bool applies(int handSize, int opponentHandSize, const EndgameConfig& config) {
+        return handSize <= config.handThreshold || opponentHandSize <= config.opponentThreshold;
+    }
+
+    //it picks the move for a hand against the next seat, where drawStack is the number of cards waiting to be drawn
+    //discarded is the discard pile, whose cards are seen and can not be drawn or held,
+    //or nullptr with the infinite deck where every draw is a fresh card
+    static EndgameResult solve(const std::vector<Card>& hand, const Card& topCard, int drawStack,
+                               int opponentHandSize, const OpponentModel& opponentModel,
+                               const HandCounts* discarded, const EndgameConfig& config);
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "gamerecord.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//it is how many bytes of finished games a writer keeps before it appends them
+const size_t RECORD_FLUSH_BYTES = 1 << 16;
+
+//it writes a number 7 bits at a time with the high bit set on every byte but the last
+static void writeVarint(vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+//it reads a varint and returns false if it runs past the end
+static bool readVarint(const uint8_t*& in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (in >= end) return false;
+        uint8_t byte = *in++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// ------- FILE -------------- FILE -------------- FILE -------------- FILE -------------- FILE -------------- FILE -------
+
+//it opens the file for appending so a record file can grow over many runs
+bool GameRecordFile::open(const string& path) {
+    close();
+
+    //it checks the magic of a file that already has games in it
+    FILE* existing = fopen(path.c_str(), "rb");
+    if (existing) {
+        char magic[sizeof(GAME_RECORD_MAGIC)];
+        size_t got = fread(magic, 1, sizeof(magic), existing);
+        fclose(existing);
+        if (got != 0 && (got != sizeof(magic) || memcmp(magic, GAME_RECORD_MAGIC, sizeof(magic)) != 0)) {
+            return false;
+        }
+    }
+
+    file = fopen(path.c_str(), "ab");
+    if (!file) {
+        return false;
+    }
+
+    //it writes the magic only at the start of a new file
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        fwrite(GAME_RECORD_MAGIC, 1, sizeof(GAME_RECORD_MAGIC), file);
+    }
+    return true;
+}
+
+void GameRecordFile::append(const uint8_t* bytes, size_t count) {
+    lock_guard<mutex> guard(lock);
+    if (file && count > 0) {
+        fwrite(bytes, 1, count, file);
+    }
+}
+
+void GameRecordFile::close() {
+    lock_guard<mutex> guard(lock);
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+// ------- WRITER -------------- WRITER -------------- WRITER -------------- WRITER -------------- WRITER -------------- WRITER -------
+
+GameRecordWriter::GameRecordWriter(GameRecordFile& file)
+    : file(file), seed(0), numPlayers(0), numAI(0), infiniteDeck(false), recording(false) {}
+
+//it keeps the unfinished game and every buffered game when the writer goes away
+GameRecordWriter::~GameRecordWriter() {
+    if (recording) {
+        encodeGame(false, -1);
+    }
+    flush();
+}
+
+void GameRecordWriter::beginGame(unsigned int gameSeed, int players, int ai, bool infinite) {
+    if (recording) {
+        encodeGame(false, -1);
+    }
+    seed = gameSeed;
+    numPlayers = players;
+    numAI = ai;
+    infiniteDeck = infinite;
+    moves.clear();
+    strategies.assign(players, -1);
+    recording = true;
+}
+
+void GameRecordWriter::recordMove(const Game& game, int cardIndex) {
+    if (!recording) return;
+
+    if (moves.empty()) {
+        for (int p = 0; p < numPlayers && p < (int)game.getPlayers().size(); p++) {
+            strategies[p] = game.getPlayers()[p].getStrategy();
+        }
+    }
+
+    if (cardIndex == -1) {
+        writeVarint(moves, GAME_RECORD_DRAW);
+    }
+    else if (cardIndex >= 0) {
+        writeVarint(moves, GAME_RECORD_FIRST_CARD + (uint32_t)cardIndex);
+    }
+    //a negative index other than -1 makes Game::playTurn return before it changes anything
+}
+
+void GameRecordWriter::recordColor(cardColor color) {
+    if (!recording) return;
+    writeVarint(moves, GAME_RECORD_COLOR + (uint32_t)color);
+}
+
+void GameRecordWriter::endGame(const Game& game) {
+    if (!recording) return;
+    encodeGame(game.getState() == GAME_OVER, game.getWinner());
+}
+
+void GameRecordWriter::flush() {
+    file.append(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+//it adds the game being recorded to the buffer and appends the buffer once it is big enough
+void GameRecordWriter::encodeGame(bool finished, int winner) {
+    writeVarint(buffer, seed);
+    buffer.push_back((uint8_t)numPlayers);
+    buffer.push_back((uint8_t)numAI);
+    buffer.push_back((infiniteDeck ? GAME_RECORD_INFINITE_DECK : 0) | (finished ? GAME_RECORD_FINISHED : 0));
+    buffer.push_back((uint8_t)(winner + 1));
+    for (int strategy : strategies) {
+        writeVarint(buffer, (uint32_t)(strategy + 1));
+    }
+    writeVarint(buffer, moves.size());
+    buffer.insert(buffer.end(), moves.begin(), moves.end());
+    recording = false;
+
+    if (buffer.size() >= RECORD_FLUSH_BYTES) {
+        flush();
+    }
+}
+
+// ------- READER -------------- READER -------------- READER -------------- READER -------------- READER -------------- READER -------
+
+#ifdef _WIN32
+GameRecordReader::GameRecordReader() : data(nullptr), size(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+#else
+GameRecordReader::GameRecordReader() : data(nullptr), size(0) {}
+#endif
+
+GameRecordReader::~GameRecordReader() {
+    close();
+}
+
+bool GameRecordReader::open(const string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fileH = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileH == INVALID_HANDLE_VALUE) return false;
+    fileHandle = fileH;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileH, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(GAME_RECORD_MAGIC)) {
+        close();
+        return false;
+    }
+    size = (size_t)fileSize.QuadPart;
+    mappingHandle = CreateFileMappingA(fileH, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(GAME_RECORD_MAGIC)) {
+        ::close(fd);
+        return false;
+    }
+    size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //it keeps the mapping after the descriptor is closed
+    data = mapped == MAP_FAILED ? nullptr : (const uint8_t*)mapped;
+    if (data) {
+        madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (!data || memcmp(data, GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC)) != 0) {
+        close();
+        return false;
+    }
+
+    //it walks the games once, skipping each one by its length, and stops at a game that was cut off
+    const uint8_t* in = data + sizeof(GAME_RECORD_MAGIC);
+    const uint8_t* end = data + size;
+    while (in < end) {
+        const uint8_t* start = in;
+        uint32_t value;
+        if (!readVarint(in, end, value) || end - in < 4) break;
+        int numPlayers = in[0];
+        in += 4;
+        bool complete = true;
+        for (int p = 0; p < numPlayers && complete; p++) {
+            complete = readVarint(in, end, value);
+        }
+        if (!complete || !readVarint(in, end, value) || (size_t)(end - in) < value) break;
+        in += value;
+        offsets.push_back(start - data);
+    }
+    return true;
+}
+
+void GameRecordReader::close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (data) munmap((void*)data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    offsets.clear();
+}
+
+//it decodes a game that open already checked fits in the file
+bool GameRecordReader::readGame(int index, GameRecord& record) const {
+    if (index < 0 || index >= (int)offsets.size()) {
+        return false;
+    }
+
+    const uint8_t* in = data + offsets[index];
+    const uint8_t* end = data + size;
+    uint32_t value;
+    readVarint(in, end, value);
+    record.seed = value;
+    record.numPlayers = in[0];
+    record.numAI = in[1];
+    record.infiniteDeck = (in[2] & GAME_RECORD_INFINITE_DECK) != 0;
+    record.finished = (in[2] & GAME_RECORD_FINISHED) != 0;
+    record.winner = (int)in[3] - 1;
+    in += 4;
+
+    record.strategies.resize(record.numPlayers);
+    for (int p = 0; p < record.numPlayers; p++) {
+        readVarint(in, end, value);
+        record.strategies[p] = (int)value - 1;
+    }
+    readVarint(in, end, value);
+    record.movesSize = value;
+    record.moves = in;
+
+    //it counts the moves by the bytes that end a varint
+    record.numMoves = 0;
+    for (int b = 0; b < record.movesSize; b++) {
+        record.numMoves += !(in[b] & 0x80);
+    }
+    return true;
+}
+
+//it sets the game up with the recorded seed and strategies and feeds it the recorded moves
+bool GameRecordReader::replay(int index, Game& game) const {
+    GameRecord record;
+    if (!readGame(index, record) || record.numPlayers == 0) {
+        return false;
+    }
+
+    game.setInfiniteDeck(record.infiniteDeck);
+    game.initialize(record.numPlayers, record.numAI, record.seed);
+    for (int p = 0; p < record.numPlayers; p++) {
+        game.getPlayer(p).setStrategy(record.strategies[p]);
+    }
+
+    const uint8_t* in = record.moves;
+    const uint8_t* end = record.moves + record.movesSize;
+    while (in < end) {
+        uint32_t move;
+        if (!readVarint(in, end, move)) return false;
+        if (move == GAME_RECORD_DRAW) {
+            game.playTurn(-1);
+        }
+        else if (move < GAME_RECORD_FIRST_CARD) {
+            if (move - GAME_RECORD_COLOR > YELLOWS) return false;
+            game.chooseColorForWild(static_cast<cardColor>(move - GAME_RECORD_COLOR));
+        }
+        else {
+            game.playTurn(move - GAME_RECORD_FIRST_CARD);
+        }
+    }
+
+    //it checks that the replay ended the same way the recorded game did
+    if (record.finished) {
+        return game.getState() == GAME_OVER && game.getWinner() == record.winner;
+    }
+    return true;
+}
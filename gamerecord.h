@@ -0,0 +1,130 @@
+#ifndef GAMERECORD_H
+#define GAMERECORD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "deck.h"
+
+//it is the binary game record format
+//the file starts with the 8 byte GAME_RECORD_MAGIC, then every game is:
+//  varint seed, numPlayers byte, numAI byte, flags byte, winner + 1 byte,
+//  varint strategy id + 1 for each player, varint byte length of the moves, then one varint per move
+//a move is GAME_RECORD_DRAW for Game::playTurn(-1), GAME_RECORD_COLOR plus the color for Game::chooseColorForWild,
+//or GAME_RECORD_FIRST_CARD plus the hand index for Game::playTurn, so every index fits however big a hand gets
+//and an index below 122 still takes one byte
+//since the deck is seeded and the AI picks are deterministic, the seed and the moves replay the whole game
+const char GAME_RECORD_MAGIC[8] = { 'U', 'N', 'O', 'R', 'E', 'C', '0', '2' };
+const uint32_t GAME_RECORD_DRAW = 0;
+const uint32_t GAME_RECORD_COLOR = 1;
+const uint32_t GAME_RECORD_FIRST_CARD = GAME_RECORD_COLOR + WILDS + 1;
+const uint8_t GAME_RECORD_INFINITE_DECK = 1;  //it is the flag for a game played with the infinite deck
+const uint8_t GAME_RECORD_FINISHED = 2;       //it is the flag for a game that reached GAME_OVER
+
+//it is one decoded game, whose moves point into the readers memory map
+struct GameRecord {
+    unsigned int seed;
+    int numPlayers;
+    int numAI;
+    bool infiniteDeck;
+    bool finished;
+    int winner;
+    std::vector<int> strategies;
+    const uint8_t* moves;         //it is the encoded moves
+    int movesSize;                //it is how many bytes the moves take
+    int numMoves;
+};
+
+//it is a record file that many writers can append whole games to, one thread at a time
+class GameRecordFile {
+private:
+    FILE* file;
+    std::mutex lock;
+
+public:
+    GameRecordFile() : file(nullptr) {}
+    ~GameRecordFile() { close(); }
+
+    //it opens a file for appending and writes the magic if the file is new
+    //it returns false for a file that starts with another magic, since appending would mix two formats
+    bool open(const std::string& path);
+
+    //it appends bytes in one piece so games from different threads never mix
+    void append(const uint8_t* data, size_t size);
+
+    void close();
+    bool isOpen() const { return file != nullptr; }
+};
+
+//it collects the moves of the game it is attached to with Game::setRecorder
+//one writer belongs to one Game at a time, and it hands finished games to the file in batches
+class GameRecordWriter {
+private:
+    GameRecordFile& file;
+    std::vector<uint8_t> buffer;  //it is the encoded games that were not appended yet
+    std::vector<uint8_t> moves;   //it is the moves of the game being played
+    std::vector<int> strategies;
+    unsigned int seed;
+    int numPlayers;
+    int numAI;
+    bool infiniteDeck;
+    bool recording;               //it is true between beginGame and the end of the game
+
+public:
+    explicit GameRecordWriter(GameRecordFile& file);
+    ~GameRecordWriter();
+
+    //it starts a new game and finishes the one before it if that one never reached GAME_OVER
+    void beginGame(unsigned int seed, int numPlayers, int numAI, bool infiniteDeck);
+
+    //it records a Game::playTurn call, reading the strategies on the first move since they are set after initialize
+    void recordMove(const Game& game, int cardIndex);
+
+    //it records a Game::chooseColorForWild call
+    void recordColor(cardColor color);
+
+    //it encodes the game into the buffer
+    void endGame(const Game& game);
+
+    //it appends the buffered games to the file
+    void flush();
+
+private:
+    void encodeGame(bool finished, int winner);
+};
+
+//it reads a record file through a memory map and finds every game once so any game can be read by index
+class GameRecordReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    std::vector<size_t> offsets;  //it is where each game starts
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    GameRecordReader();
+    ~GameRecordReader();
+    GameRecordReader(const GameRecordReader&) = delete;
+    GameRecordReader& operator=(const GameRecordReader&) = delete;
+
+    //it maps a file and indexes its games, returning false if it can not be read or is not a record file
+    bool open(const std::string& path);
+
+    void close();
+
+    //it gets how many complete games the file has
+    int getGameCount() const { return offsets.size(); }
+
+    //it decodes the header of a game and points at its moves
+    bool readGame(int index, GameRecord& record) const;
+
+    //it plays a recorded game again on a game object and returns false if the record is damaged
+    bool replay(int index, Game& game) const;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "instrument.h"
+
+#ifdef UNO_INSTRUMENT
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+using namespace std;
+
+//they are the names the probes and counters are written with, in enum order
+static const char* const PROBE_NAMES[PROBE_COUNT] = {
+    "LPOptimizer::solveLPForBestCard",
+    "GLPK build",
+    "GLPK simplex",
+    "GLPK intopt",
+    "LPOptimizer::planNextTurns",
+    "LPOptimizer::planAnytime",
+    "EndgameSolver::solve",
+    "LPOptimizer::evaluateSequence",
+    "Player::sortHand",
+    "Game::playTurn"
+};
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "plan_nodes",
+    "plan_pruned",
+    "plan_table_hits",
+    "plan_cut_short",
+    "endgame_nodes",
+    "endgame_fallbacks",
+    "mip_plans",
+    "mip_fallbacks"
+};
+
+bool Instrumentation::isEnabled() {
+#ifdef UNO_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef UNO_INSTRUMENT
+
+//it is the HDR-style layout of a histogram: values below 2^SUB_BITS get a bucket each,
+//and every power of two above that is split into 2^SUB_BITS buckets, so a bucket is never more than 1/32 of its value wide
+const int SUB_BITS = 5;
+const int SUB_BUCKETS = 1 << SUB_BITS;
+const int MAX_EXPONENT = 47;  //it is about 39 hours in nanoseconds, longer times go in the last bucket
+const int HISTOGRAM_BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUB_BUCKETS;
+
+static int bucketOf(uint64_t value) {
+    if (value < (uint64_t)SUB_BUCKETS) return (int)value;
+    int exponent = min(63 - countl_zero(value), MAX_EXPONENT);
+    int sub = (int)(min<uint64_t>(value, (2ULL << MAX_EXPONENT) - 1) >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+//it is the biggest value that lands in a bucket
+static uint64_t bucketTop(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << (exponent - SUB_BITS)) - 1;
+}
+
+struct LatencyHistogram {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t total;
+    uint64_t minimum;
+    uint64_t maximum;
+
+    void clear() {
+        fill(begin(buckets), end(buckets), 0);
+        count = 0;
+        total = 0;
+        minimum = UINT64_MAX;
+        maximum = 0;
+    }
+
+    void add(uint64_t value) {
+        buckets[bucketOf(value)]++;
+        count++;
+        total += value;
+        minimum = min(minimum, value);
+        maximum = max(maximum, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++) buckets[b] += other.buckets[b];
+        count += other.count;
+        total += other.total;
+        minimum = min(minimum, other.minimum);
+        maximum = max(maximum, other.maximum);
+    }
+
+    //it finds the value that the given fraction of the samples are at or below
+    uint64_t percentile(double fraction) const {
+        if (count == 0) return 0;
+        uint64_t rank = max<uint64_t>(1, (uint64_t)(fraction * count + 0.5));
+        uint64_t seen = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) return min(bucketTop(b), maximum);
+        }
+        return maximum;
+    }
+};
+
+//it is everything one thread recorded
+struct ThreadProbes {
+    LatencyHistogram probes[PROBE_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+
+    void clear() {
+        for (LatencyHistogram& histogram : probes) histogram.clear();
+        fill(begin(counters), end(counters), 0);
+    }
+
+    void merge(const ThreadProbes& other) {
+        for (int p = 0; p < PROBE_COUNT; p++) probes[p].merge(other.probes[p]);
+        for (int c = 0; c < COUNTER_COUNT; c++) counters[c] += other.counters[c];
+    }
+};
+
+//it is the list of threads that are recording and what the finished threads left behind
+struct ProbeRegistry {
+    mutex lock;
+    vector<ThreadProbes*> live;
+    unique_ptr<ThreadProbes> retired;
+
+    ProbeRegistry() : retired(make_unique<ThreadProbes>()) { retired->clear(); }
+};
+
+static ProbeRegistry& probeRegistry() {
+    static ProbeRegistry registry;
+    return registry;
+}
+
+//it owns the probes of one thread and hands them to the registry when the thread ends
+struct ThreadProbesOwner {
+    unique_ptr<ThreadProbes> probes;
+
+    ThreadProbesOwner() : probes(make_unique<ThreadProbes>()) {
+        probes->clear();
+        ProbeRegistry& registry = probeRegistry();
+        lock_guard<mutex> guard(registry.lock);
+        registry.live.push_back(probes.get());
+    }
+
+    ~ThreadProbesOwner() {
+        ProbeRegistry& registry = probeRegistry();
+        lock_guard<mutex> guard(registry.lock);
+        registry.retired->merge(*probes);
+        registry.live.erase(find(registry.live.begin(), registry.live.end(), probes.get()));
+    }
+};
+
+static ThreadProbes& threadProbes() {
+    thread_local ThreadProbesOwner owner;
+    return *owner.probes;
+}
+
+void Instrumentation::record(Probe probe, uint64_t nanoseconds) {
+    threadProbes().probes[probe].add(nanoseconds);
+}
+
+void Instrumentation::count(Counter counter, uint64_t amount) {
+    threadProbes().counters[counter] += amount;
+}
+
+void Instrumentation::reset() {
+    ProbeRegistry& registry = probeRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    registry.retired->clear();
+    for (ThreadProbes* probes : registry.live) probes->clear();
+}
+
+void Instrumentation::writeJson(ostream& out) {
+    auto merged = make_unique<ThreadProbes>();
+    merged->clear();
+    {
+        ProbeRegistry& registry = probeRegistry();
+        lock_guard<mutex> guard(registry.lock);
+        merged->merge(*registry.retired);
+        for (ThreadProbes* probes : registry.live) merged->merge(*probes);
+    }
+
+    out << "{\n";
+    out << "  \"enabled\": true,\n";
+    out << "  \"timers\": [\n";
+    for (int p = 0; p < PROBE_COUNT; p++) {
+        const LatencyHistogram& histogram = merged->probes[p];
+        out << "    { \"name\": \"" << PROBE_NAMES[p] << "\", \"count\": " << histogram.count
+            << ", \"total_ns\": " << histogram.total
+            << ", \"mean_ns\": " << (histogram.count > 0 ? (double)histogram.total / histogram.count : 0.0)
+            << ", \"min_ns\": " << (histogram.count > 0 ? histogram.minimum : 0)
+            << ", \"p50_ns\": " << histogram.percentile(0.5)
+            << ", \"p90_ns\": " << histogram.percentile(0.9)
+            << ", \"p99_ns\": " << histogram.percentile(0.99)
+            << ", \"p999_ns\": " << histogram.percentile(0.999)
+            << ", \"max_ns\": " << histogram.maximum << " }"
+            << (p + 1 < PROBE_COUNT ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"counters\": {\n";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << "    \"" << COUNTER_NAMES[c] << "\": " << merged->counters[c]
+            << (c + 1 < COUNTER_COUNT ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+#else
+
+//it keeps the functions so callers link the same way, but nothing calls record or count without UNO_INSTRUMENT
+void Instrumentation::record(Probe, uint64_t) {}
+void Instrumentation::count(Counter, uint64_t) {}
+void Instrumentation::reset() {}
+
+void Instrumentation::writeJson(ostream& out) {
+    out << "{\n";
+    out << "  \"enabled\": false\n";
+    out << "}\n";
+}
+
+#endif
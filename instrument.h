@@ -0,0 +1,87 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+//it is the instrumentation of the AI and game hot paths
+//it is only compiled in when UNO_INSTRUMENT is defined (cmake -DUNO_INSTRUMENT=ON), otherwise
+//UNO_TIME_SCOPE and UNO_COUNT expand to nothing so the hot paths are exactly the same as without it
+//every thread records into its own histograms and counters, which are merged when the thread ends or
+//when the results are written, so writeJson should be called once the batch is done
+
+//it is every timed scope
+enum Probe {
+    PROBE_SOLVE_LP_BEST_CARD,
+    PROBE_GLPK_BUILD,
+    PROBE_GLPK_SIMPLEX,
+    PROBE_GLPK_INTOPT,
+    PROBE_PLAN_NEXT_TURNS,
+    PROBE_PLAN_ANYTIME,
+    PROBE_ENDGAME_SOLVE,
+    PROBE_EVALUATE_SEQUENCE,
+    PROBE_SORT_HAND,
+    PROBE_PLAY_TURN,
+    PROBE_COUNT
+};
+
+//it is every counter
+enum Counter {
+    COUNTER_PLAN_NODES,         //it is the positions the sequence search visited
+    COUNTER_PLAN_PRUNED,        //it is the cards the sequence search skipped because of the bound
+    COUNTER_PLAN_TABLE_HITS,    //it is the positions the sequence search found in its table
+    COUNTER_PLAN_CUT_SHORT,     //it is the anytime depths that ran out of budget
+    COUNTER_ENDGAME_NODES,      //it is the positions the endgame solver visited
+    COUNTER_ENDGAME_FALLBACKS,  //it is the endgame moves that came from solveLPMultiTurn because the budget ran out
+    COUNTER_MIP_PLANS,          //it is the MIP plans that came from GLPK
+    COUNTER_MIP_FALLBACKS,      //it is the MIP plans that came from planNextTurns because GLPK gave no plan in time
+    COUNTER_COUNT
+};
+
+class Instrumentation {
+public:
+    //it records how long one scope took into this threads histogram
+    static void record(Probe probe, uint64_t nanoseconds);
+
+    //it adds to one of this threads counters
+    static void count(Counter counter, uint64_t amount);
+
+    //it forgets everything that was recorded so far
+    static void reset();
+
+    //it writes the merged histograms and counters of every thread as one JSON object
+    static void writeJson(std::ostream& out);
+
+    //it checks if the instrumentation was compiled in
+    static bool isEnabled();
+
+    //it times the scope it lives in
+    class ScopedTimer {
+    private:
+        Probe probe;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedTimer(Probe timedProbe) : probe(timedProbe), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            record(probe, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start).count());
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    };
+};
+
+#define UNO_INSTRUMENT_JOIN_INNER(a, b) a##b
+#define UNO_INSTRUMENT_JOIN(a, b) UNO_INSTRUMENT_JOIN_INNER(a, b)
+
+#ifdef UNO_INSTRUMENT
+#define UNO_TIME_SCOPE(probe) Instrumentation::ScopedTimer UNO_INSTRUMENT_JOIN(unoScopedTimer, __LINE__)(probe)
+#define UNO_COUNT(counter, amount) Instrumentation::count(counter, amount)
+#else
+#define UNO_TIME_SCOPE(probe) ((void)0)
+#define UNO_COUNT(counter, amount) ((void)0)
+#endif
+
+#endif
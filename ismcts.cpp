@@ -0,0 +1,318 @@
+#include "ismcts.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+using namespace std;
+
+//it lists the legal moves of the current player the same way the AI loop plays them
+int ISMCTS::legalMoves(const Game& game, int* moves) {
+    uint64_t playable = game.getCurrentPlayer().getHandCounts().playable(game.getTopCard());
+
+    //it only allows another draw card on top of a draw stack
+    if (game.getDrawStack() > 0) {
+        playable &= HandCounts::typeMask(DRAW_TWO) | HandCounts::typeMask(WILD_DRAW_FOUR);
+    }
+
+    int count = 0;
+    while (playable) {
+        moves[count++] = std::countr_zero(playable);
+        playable &= playable - 1;
+    }
+
+    //it draws only when nothing can be played like the other AIs do
+    if (count == 0) {
+        moves[count++] = ISMCTS_DRAW_MOVE;
+    }
+    return count;
+}
+
+//it plays a move on a game, choosing a color for a human wild so the game keeps going
+void ISMCTS::applyMove(Game& game, int move) {
+    if (move == ISMCTS_DRAW_MOVE) {
+        game.playTurn(-1);
+        return;
+    }
+
+    Player& player = game.getCurrentPlayer();
+    const vector<Card>& hand = player.getHand();
+    for (int i = 0; i < (int)hand.size(); i++) {
+        if (HandCounts::slotOf(hand[i]) == move) {
+            game.playTurn(i);
+            break;
+        }
+    }
+
+    if (game.getState() == WAITING_FOR_COLOR_CHOICE) {
+        game.chooseColorForWild(player.chooseBestColor(game.getTopCard()));
+    }
+}
+
+//it is how likely Deck::draw makes the card in a slot in infinite mode, where every type is as likely and a
+//colored type is then split over the four colors
+static int infiniteDeckWeight(int slot) {
+    return HandCounts::cardOf(slot).isWild() ? 4 : 1;
+}
+
+//it replaces every hidden hand and the draw pile with a sample that fits what the observer knows
+//the observer has seen its own hand, the top card and the discard pile, so the unseen cards are the draw pile
+//and the other hands together: the hands are dealt from them with the colors of each seat weighted by how likely
+//the observers TableModel thinks that seat holds them, and the cards left over are shuffled into the draw pile
+//an infinite deck has no pile to deal from, so there every hidden card is drawn the way Deck::draw makes one
+//sampledHand and drawPile are buffers kept by the tree so a determinization does not allocate
+static void determinize(Game& game, int observer, const TableModel& table, FastRng& rng,
+                        vector<Card>& sampledHand, vector<Card>& drawPile) {
+    bool infinite = game.isInfiniteDeck();
+    int numSeats = game.getPlayers().size();
+    int unseen[HAND_SLOTS] = {};
+    if (infinite) {
+        for (int s = 0; s < HAND_SLOTS; s++) unseen[s] = infiniteDeckWeight(s);
+    }
+    else {
+        for (const Card& card : game.getDeck().getCards()) unseen[HandCounts::slotOf(card)]++;
+        for (int seat = 0; seat < numSeats; seat++) {
+            if (seat == observer) continue;
+            const HandCounts& hidden = game.getPlayers()[seat].getHandCounts();
+            for (int s = 0; s < HAND_SLOTS; s++) unseen[s] += hidden.counts[s];
+        }
+    }
+
+    for (int seat = 0; seat < numSeats; seat++) {
+        if (seat == observer) continue;
+
+        double colorWeights[5];
+        for (int c = 0; c < 5; c++) {
+            colorWeights[c] = seat < table.numSeats ? max(0.05, table.probabilityHasColor[c][seat]) : 1.0;
+        }
+        double weights[HAND_SLOTS];
+        for (int s = 0; s < HAND_SLOTS; s++) {
+            weights[s] = colorWeights[HandCounts::cardOf(s).color];
+        }
+
+        //it never runs out, since the unseen cards are at least every hidden hand put together
+        sampledHand.clear();
+        int handSize = game.getPlayers()[seat].getHandSize();
+        for (int c = 0; c < handSize; c++) {
+            double total = 0.0;
+            for (int s = 0; s < HAND_SLOTS; s++) total += unseen[s] * weights[s];
+
+            double pick = rng.nextDouble() * total;
+            int slot = 0;
+            for (; slot < HAND_SLOTS - 1; slot++) {
+                pick -= unseen[slot] * weights[slot];
+                if (pick < 0.0 && unseen[slot] > 0) break;
+            }
+            if (unseen[slot] == 0) {
+                //it guards against rounding at the end of the scan
+                slot = 0;
+                while (unseen[slot] == 0) slot++;
+            }
+            if (!infinite) unseen[slot]--;
+            sampledHand.push_back(HandCounts::cardOf(slot));
+        }
+        game.getPlayer(seat).setHand(sampledHand);
+    }
+
+    if (infinite) return;
+    drawPile.clear();
+    for (int s = 0; s < HAND_SLOTS; s++) {
+        for (int k = 0; k < unseen[s]; k++) drawPile.push_back(HandCounts::cardOf(s));
+    }
+    game.setDrawPile(drawPile);
+    assert(game.countCards() == DECK_SIZE && "a determinized world must still hold exactly the 108 cards");
+}
+
+//it scores the end of a playout for one seat: a win is 1, and an unfinished game goes to the smallest hand
+static double playoutReward(const Game& game, int seat) {
+    if (game.getState() == GAME_OVER) {
+        return game.getWinner() == seat ? 1.0 : 0.0;
+    }
+
+    const vector<Player>& players = game.getPlayers();
+    int mySize = players[seat].getHandSize();
+    int smaller = 0, equal = 0;
+    for (int p = 0; p < (int)players.size(); p++) {
+        if (p == seat) continue;
+        if (players[p].getHandSize() < mySize) smaller++;
+        else if (players[p].getHandSize() == mySize) equal++;
+    }
+    if (smaller > 0) return 0.0;
+    return 1.0 / (equal + 1);
+}
+
+//it adds a node to the pool and links it under its parent
+static int addNode(vector<ISMCTSNode>& pool, int move, int playerJustMoved, int parent) {
+    ISMCTSNode node = { move, playerJustMoved, parent, -1, -1, 0, 1, 0.0 };
+    if (parent != -1) {
+        node.nextSibling = pool[parent].firstChild;
+        pool[parent].firstChild = pool.size();
+    }
+    pool.push_back(node);
+    return pool.size() - 1;
+}
+
+//it grows one tree from the root game and returns how many iterations it ran
+static int runTree(const Game& root, const ISMCTSConfig& config, unsigned int seed,
+                   chrono::steady_clock::time_point deadline, vector<ISMCTSNode>& pool) {
+    FastRng rng(seed);
+
+    //it reserves one node per iteration up front since each iteration expands at most one node
+    pool.clear();
+    pool.reserve((size_t)config.iterations + 1);
+    addNode(pool, -1, -1, -1);
+
+    int observer = root.getCurrentPlayerIndex();
+    const TableModel& table = root.getCurrentPlayer().getTableModel();
+
+    int moves[HAND_SLOTS + 1];
+    bool tried[HAND_SLOTS + 1];
+    int untried[HAND_SLOTS + 1];
+    Game game;
+    vector<Card> sampledHand, drawPile;
+    sampledHand.reserve(DECK_SIZE);
+    drawPile.reserve(DECK_SIZE);
+
+    int iteration = 0;
+    for (; iteration < config.iterations; iteration++) {
+        //it checks the clock every few iterations so timing stays cheap
+        if (config.timeBudgetMs > 0.0 && (iteration & 15) == 0 && chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+
+        //it samples one possible world that fits what the observer knows
+        game = root;
+        game.reseed(rng());
+        determinize(game, observer, table, rng, sampledHand, drawPile);
+
+        //it walks down the tree choosing among the moves that are legal in this world
+        int node = 0;
+        while (game.getState() == GAME_PLAYING) {
+            int numMoves = ISMCTS::legalMoves(game, moves);
+            int mover = game.getCurrentPlayerIndex();
+
+            for (int m = 0; m <= HAND_SLOTS; m++) tried[m] = false;
+            for (int child = pool[node].firstChild; child != -1; child = pool[child].nextSibling) {
+                tried[pool[child].move] = true;
+            }
+
+            int numUntried = 0;
+            for (int m = 0; m < numMoves; m++) {
+                if (!tried[moves[m]]) untried[numUntried++] = moves[m];
+            }
+
+            //it counts this visit as a chance for every legal child to have been picked
+            bool legal[HAND_SLOTS + 1] = {};
+            for (int m = 0; m < numMoves; m++) legal[moves[m]] = true;
+            for (int child = pool[node].firstChild; child != -1; child = pool[child].nextSibling) {
+                if (legal[pool[child].move]) pool[child].availability++;
+            }
+
+            //it expands one untried move and leaves the rest of the game to the playout
+            if (numUntried > 0) {
+                int move = untried[rng.below(numUntried)];
+                node = addNode(pool, move, mover, node);
+                ISMCTS::applyMove(game, move);
+                break;
+            }
+
+            //it picks the legal child with the best upper confidence bound
+            int bestChild = -1;
+            double bestScore = -1.0;
+            for (int child = pool[node].firstChild; child != -1; child = pool[child].nextSibling) {
+                const ISMCTSNode& c = pool[child];
+                if (!legal[c.move]) continue;
+                double score = c.totalReward / c.visits +
+                    config.exploration * sqrt(log((double)c.availability) / c.visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestChild = child;
+                }
+            }
+            node = bestChild;
+            ISMCTS::applyMove(game, pool[node].move);
+        }
+
+        //it plays random legal moves until the game ends or the playout gets too long
+        for (int turns = 0; game.getState() == GAME_PLAYING && turns < config.rolloutTurnLimit; turns++) {
+            int numMoves = ISMCTS::legalMoves(game, moves);
+            ISMCTS::applyMove(game, moves[rng.below(numMoves)]);
+        }
+
+        //it sends the result back up, each node scoring it for the seat that moved into it
+        for (; node != -1; node = pool[node].parent) {
+            pool[node].visits++;
+            if (pool[node].playerJustMoved >= 0) {
+                pool[node].totalReward += playoutReward(game, pool[node].playerJustMoved);
+            }
+        }
+    }
+    return iteration;
+}
+
+//it runs one tree per thread from the same root and merges the root visit counts
+ISMCTSResult ISMCTS::search(const Game& game, const ISMCTSConfig& config) {
+    ISMCTSResult result = { -1, ISMCTS_DRAW_MOVE, 0, 0 };
+
+    //it skips the search when there is only one thing to do
+    int moves[HAND_SLOTS + 1];
+    int numMoves = ISMCTS::legalMoves(game, moves);
+    if (numMoves == 1) {
+        result.move = moves[0];
+    }
+    else {
+        auto deadline = chrono::steady_clock::now() +
+            chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(config.timeBudgetMs));
+
+        int numThreads = max(1, config.threads);
+        vector<vector<ISMCTSNode>> pools(numThreads);
+        vector<int> iterations(numThreads, 0);
+
+        if (numThreads == 1) {
+            iterations[0] = runTree(game, config, config.seed, deadline, pools[0]);
+        }
+        else {
+            vector<thread> workers;
+            for (int t = 0; t < numThreads; t++) {
+                workers.emplace_back([&, t]() {
+                    iterations[t] = runTree(game, config, config.seed + 7919u * t, deadline, pools[t]);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        //it adds up the visits of each root move across all trees
+        int visits[HAND_SLOTS + 1] = {};
+        for (int t = 0; t < numThreads; t++) {
+            result.iterations += iterations[t];
+            for (int child = pools[t][0].firstChild; child != -1; child = pools[t][child].nextSibling) {
+                visits[pools[t][child].move] += pools[t][child].visits;
+            }
+        }
+        for (int m = 0; m < numMoves; m++) {
+            if (visits[moves[m]] > result.visits) {
+                result.visits = visits[moves[m]];
+                result.move = moves[m];
+            }
+        }
+        if (result.visits == 0) {
+            result.move = moves[0];
+        }
+    }
+
+    //it turns the chosen slot into an index in the current players hand
+    if (result.move != ISMCTS_DRAW_MOVE) {
+        const vector<Card>& hand = game.getCurrentPlayer().getHand();
+        for (int i = 0; i < (int)hand.size(); i++) {
+            if (HandCounts::slotOf(hand[i]) == result.move) {
+                result.cardIndex = i;
+                break;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef ISMCTS_H
+#define ISMCTS_H
+
+#include <vector>
+#include "deck.h"
+
+//it is the move that means draw a card instead of playing one
+//every other move is the HandCounts slot of the card that is played
+const int ISMCTS_DRAW_MOVE = HAND_SLOTS;
+
+//it is the settings of an ISMCTS search
+struct ISMCTSConfig {
+    int iterations = 1000;        //it is the most iterations each thread runs
+    double timeBudgetMs = 0.0;    //it is the wall-clock budget in milliseconds, 0 means only the iteration limit counts
+    int threads = 1;              //it is how many independent trees are searched in parallel and merged at the root
+    double exploration = 0.7;     //it is the UCB exploration constant
+    int rolloutTurnLimit = 200;   //it is how many turns a random playout may take before it is scored by hand size
+    unsigned int seed = 0;        //it is the seed of the sampling and playout randomness
+};
+
+//it is the result of an ISMCTS search
+struct ISMCTSResult {
+    int cardIndex;   //it is the index in the current players hand to play or -1 to draw
+    int move;        //it is the chosen slot or ISMCTS_DRAW_MOVE
+    int iterations;  //it is how many iterations all threads ran together
+    int visits;      //it is how many times the chosen move was visited
+};
+
+//it is one node of the search tree
+//nodes live in a pool and link to each other by index so a search never allocates per node
+struct ISMCTSNode {
+    int move;             //it is the move that led here
+    int playerJustMoved;  //it is the seat that made that move so rewards are counted for them
+    int parent;
+    int firstChild;
+    int nextSibling;
+    int visits;
+    int availability;     //it is how many times this move was legal when its parent was visited
+    double totalReward;
+};
+
+//it is the information-set Monte Carlo tree search AI
+//every iteration deals the hidden opponent hands and the draw pile again from the cards the current player
+//has not seen, weighted by the TableModel, plays the tree and a random
+//playout with the normal Game rules, and the move with the most visits is chosen
+class ISMCTS {
+public:
+    //it searches from the current players point of view and returns the chosen move
+    static ISMCTSResult search(const Game& game, const ISMCTSConfig& config);
+
+    //it lists the legal moves of the current player the same way the AI loop plays them
+    //it returns how many moves were written to moves, which needs room for HAND_SLOTS + 1 entries
+    static int legalMoves(const Game& game, int* moves);
+
+    //it plays a move on a game, choosing a color for a human wild so the game keeps going
+    static void applyMove(Game& game, int move);
+};
+
+#endif
@@ -10,6 +10,10 @@
 #include <map>
 #include <vector>
 #include "deck.h"
+#include "strategy.h"
+#include "gamerecord.h"
+#include "aiworker.h"
+#include "decisioncache.h"
 
 //https://www.raylib.com
 //https://www.raylib.com/cheatsheet/cheatsheet.html
@@ -37,6 +41,13 @@ const int CARD_SPACING = 5;
 float aiTurnDelay = 0.0f;
 const float AI_TURN_WAIT = 0.5f;
 
+//it is how long the AI can think before it plays the greedy move instead, counted from the start of its turn
+const double AI_DECISION_DEADLINE = 2.0;
+
+//it is the decision cache the AI keeps between sessions, which UnoSimulator --cache-file can also fill
+const char* const DECISION_CACHE_FILE = "uno_decisions.cache";
+const size_t DECISION_CACHE_ENTRIES = 1 << 20;
+
 //it is that game states for main menu
 enum MenuState {
     MENU_MAIN,
@@ -50,6 +61,20 @@ int main() {
 
     //the game's variables for the game play to make it work
     Game game;
+
+    //it archives every game that is played into the record file next to the game
+    GameRecordFile recordFile;
+    GameRecordWriter recordWriter(recordFile);
+    if (recordFile.open("uno_games.rec")) {
+        game.setRecorder(&recordWriter);
+    }
+    //it remembers the AI decisions of earlier sessions so positions seen before are played right away
+    DecisionCache& decisionCache = DecisionCache::instance();
+    decisionCache.configure(DECISION_CACHE_ENTRIES);
+    decisionCache.load(DECISION_CACHE_FILE);
+
+    //it works out the AI moves off the render thread
+    AIWorker aiWorker;
     MenuState menuState = MENU_MAIN;
     int numPlayers = 1;
     int numAI = 1;
@@ -66,6 +91,7 @@ int main() {
             if (IsButtonClicked(SCREEN_WIDTH/2 - 100, 250, 200, 50)) {
                 numPlayers = 2;
                 numAI = 1;
+                aiWorker.cancel();
                 game.initialize(numPlayers, numAI);
                 menuState = MENU_GAME;
             }
@@ -97,49 +123,17 @@ int main() {
                 const Player& currentPlayer = game.getCurrentPlayer();
 
                 if (currentPlayer.getISAI()) {
+                    //it asks the strategy this AI was given for its move at the start of the turn, which is -1 to draw
+                    //it also handles the draw stack by only stacking another draw card
+                    //the worker thinks while the turn delay runs, so the delay hides the thinking time
+                    if (!aiWorker.isPending()) {
+                        aiWorker.request(game, GetRandomValue(0, 1 << 30), AI_DECISION_DEADLINE);
+                    }
                     aiTurnDelay += GetFrameTime();
 
-                    if (aiTurnDelay >= AI_TURN_WAIT) {
-                        const vector<Player>& players = game.getPlayers();
-                        int nextPlayerIndex = game.isClockwise() ?
-                            (game.getCurrentPlayerIndex() + 1) % players.size() :
-                            (game.getCurrentPlayerIndex() - 1 + players.size()) % players.size();
-                        int opponentHandSize = players[nextPlayerIndex].getHandSize();
-
-                        //it checks if there's a draw stack that needs to be handled or worked on
-                        if (game.getDrawStack() > 0) {
-                            //it tries to find a Draw 2 or Wild Draw 4 to stack using advanced AI
-                            int cardToPlay = currentPlayer.chooseOptimalCardAdvanced(game.getTopCard(), opponentHandSize, 3);
-
-                            const Card& topCard = game.getTopCard();
-                            bool canStack = false;
-
-                            if (cardToPlay != -1) {
-                                const Card& selectedCard = currentPlayer.getHand()[cardToPlay];
-                                if (selectedCard.type == DRAW_TWO || selectedCard.type == WILD_DRAW_FOUR) {
-                                    canStack = true;
-                                }
-                            }
-
-                            if (canStack) {
-                                game.playTurn(cardToPlay);//it is the stacks for another draw card
-                            }
-                            else {
-                                game.playTurn(-1);//it draws the cards and skip turn
-                            }
-                        }
-                        else {
-                            //it is the normal turn when nothing special happens
-                            //it uses the advanced AI with multi-turn planning and opponent modeling
-                            int cardToPlay = currentPlayer.chooseOptimalCardAdvanced(game.getTopCard(), opponentHandSize, 3);
-
-                            if (cardToPlay == -1) {
-                                game.playTurn(-1); //it is for the draw a card
-                            }
-                            else {
-                                game.playTurn(cardToPlay);//it is the play the chosen card
-                            }
-                        }
+                    int cardToPlay;
+                    if (aiTurnDelay >= AI_TURN_WAIT && aiWorker.poll(cardToPlay)) {
+                        game.playTurn(cardToPlay);
 
                         aiTurnDelay = 0.0f;
                     }
@@ -176,6 +170,7 @@ int main() {
             else if (state == GAME_OVER) {
                 //it checks for the restart button
                 if (IsButtonClicked(SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2 + 100, 200, 50)) {
+                    aiWorker.cancel();
                     game.initialize(numPlayers, numAI);
                 }
                 //it checks for main menu button
@@ -311,6 +306,8 @@ int main() {
         EndDrawing();
     }
 
+    aiWorker.cancel();
+    decisionCache.save(DECISION_CACHE_FILE);
     CloseWindow();
     return 0;
 }
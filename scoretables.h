@@ -0,0 +1,304 @@
+#ifndef SCORETABLES_H
+#define SCORETABLES_H
+
+#include <array>
+#include <type_traits>
+#include <utility>
+#include "deck.h"
+
+//it is the card scoring rules of LPOptimizer and the lookup tables built from them at compile time
+//every score only depends on the card type and on which side of a few hand size thresholds the hands are,
+//so the rules are written once here as constexpr functions and the tables are filled by calling them,
+//and the static_asserts at the bottom check the tables against the rules over every hand size a game can have
+//the numbers the rules and the planner score with are a weight vector, so the tuner can try other values at runtime,
+//and the compile-time tables are the ones built from DEFAULT_AI_WEIGHTS
+
+const int CARD_TYPES = WILD_DRAW_FOUR + 1;
+
+constexpr bool isWildType(cardValue type) {
+    return type == WILD || type == WILD_DRAW_FOUR;
+}
+
+// ------ WEIGHTS ------------ WEIGHTS ------------ WEIGHTS ------------ WEIGHTS ------------ WEIGHTS ------------ WEIGHTS ------
+
+//it is each number of the scoring that can be tuned
+//the hand size thresholds are left out since they are the buckets the tables are split at
+enum AIWeightId {
+    WEIGHT_WILD_DRAW_FOUR,      //it is the base utility of a wild draw four
+    WEIGHT_WILD,                //it is the base utility of a wild
+    WEIGHT_DRAW_TWO,            //it is the base utility of a draw two
+    WEIGHT_SKIP,                //it is the base utility of a skip
+    WEIGHT_REVERSE,             //it is the base utility of a reverse
+    WEIGHT_NUMBER_BASE,         //it is the base utility of a 0
+    WEIGHT_NUMBER_STEP,         //it is how much each number above 0 adds to the utility
+    WEIGHT_SHORT_HAND,          //it is added to every card when the AI holds 2 or fewer
+    WEIGHT_DEFENSIVE,           //it is added to draw twos, wild draw fours and skips when the opponent holds 2 or fewer
+    WEIGHT_HOLD_WILD,           //it is added to wilds when the AI holds more than 5
+    WEIGHT_ATTACKING_SHARE,     //it is how much of calcCard's strategic value is the attacking value
+    WEIGHT_DEFENDING_SHARE,     //it is how much of calcCard's strategic value is the defending value
+    WEIGHT_BLOCK_PENALTY,       //it is what a sequence loses per card times the chance the opponent can block it
+    WEIGHT_POINT_BONUS,         //it is what a sequence gains per point of a card for each card from it to the end
+    WEIGHT_LENGTH_BONUS,        //it is what a sequence gains per card it plays
+    WEIGHT_VERSATILITY_BASE,    //it is the versatility of a colored card that connects with nothing
+    WEIGHT_VERSATILITY_COLOR,   //it is what each held card of the same color adds to the versatility
+    WEIGHT_VERSATILITY_TYPE,    //it is what each held card of the same type adds to the versatility
+    WEIGHT_VERSATILITY_WILD,    //it is the versatility of a wild
+    AI_WEIGHT_COUNT
+};
+
+using AIWeightVector = std::array<double, AI_WEIGHT_COUNT>;
+
+//it is the weights the AI plays with unless a tuner gives it others
+constexpr AIWeightVector DEFAULT_AI_WEIGHTS = {
+    10.0, 8.0, 7.0, 6.0, 6.0,    //it is the base utility of each action card
+    2.0, 1.0,                    //it is the number cards, 2 + the number
+    5.0, 8.0, 3.0,               //it is the hand size bonuses
+    0.6, 0.4,                    //it is the calcCard split
+    2.0, 0.1, 5.0,               //it is the sequence penalty and bonuses
+    2.0, 0.5, 0.3, 10.0          //it is the versatility
+};
+
+//it is the name of each weight in the order of AIWeightId, which is what checkpoint files use
+constexpr const char* AI_WEIGHT_NAMES[AI_WEIGHT_COUNT] = {
+    "wild_draw_four", "wild", "draw_two", "skip", "reverse",
+    "number_base", "number_step",
+    "short_hand", "defensive", "hold_wild",
+    "attacking_share", "defending_share",
+    "block_penalty", "point_bonus", "length_bonus",
+    "versatility_base", "versatility_color", "versatility_type", "versatility_wild"
+};
+
+// ------ RULES ------------ RULES ------------ RULES ------------ RULES ------------ RULES ------------ RULES ------
+
+//it is the utility rule of LPOptimizer::getCardUtility
+constexpr double cardUtilityRule(cardValue type, int handSize, int opponentHandSize,
+                                 const AIWeightVector& weights = DEFAULT_AI_WEIGHTS) {
+    double utility = 0.0;
+
+    //it assigns base utility values to each card type for the AI to know which cards are better
+    switch (type) {
+        case WILD_DRAW_FOUR:
+            utility = weights[WEIGHT_WILD_DRAW_FOUR]; //it is the most powerful card so it gets the highest value
+            break;
+        case WILD:
+            utility = weights[WEIGHT_WILD]; //it is very useful for changing colors
+            break;
+        case DRAW_TWO:
+            utility = weights[WEIGHT_DRAW_TWO]; //it is a strong offensive card
+            break;
+        case SKIP:
+            utility = weights[WEIGHT_SKIP]; //it is a tactical card that skips the opponent
+            break;
+        case REVERSE:
+            utility = weights[WEIGHT_REVERSE]; //it is a tactical card that changes direction
+            break;
+        default: //it is for the number cards 0-9
+            //it gets the utility based on the cards value so higher numbers are slightly better
+            utility = weights[WEIGHT_NUMBER_BASE] + weights[WEIGHT_NUMBER_STEP] * static_cast<int>(type);
+            break;
+    }
+
+    //it adjusts the utility when the AI is close to winning with 2 or fewer cards
+    if (handSize <= 2) {
+        utility += weights[WEIGHT_SHORT_HAND]; //it boosts all cards because the AI just wants to get rid of cards
+    }
+
+    //it adjusts the utility when the opponent is close to winning with 2 or fewer cards
+    if (opponentHandSize <= 2) {
+        //it prioritizes cards that can disrupt the opponent from winning
+        if (type == DRAW_TWO || type == WILD_DRAW_FOUR || type == SKIP) {
+            utility += weights[WEIGHT_DEFENSIVE]; //it gives a significant boost to defensive cards
+        }
+    }
+
+    //it makes wild cards more valuable when the AI has many cards because they provide flexibility
+    if (isWildType(type) && handSize > 5) {
+        utility += weights[WEIGHT_HOLD_WILD]; //it tells the AI to hold onto wilds when it has options
+    }
+
+    return utility;
+}
+
+//it is the attacking rule of LPOptimizer::calcAttackingValue
+constexpr double attackingValueRule(cardValue type, int handSize) {
+    double value = 0.0;
+
+    //it assigns base values for each card type
+    switch (type) {
+        case WILD:
+            value = 0.5;
+            break;
+        case WILD_DRAW_FOUR:
+            value = 0.7;
+            break;
+        case DRAW_TWO:
+            value = 0.4;
+            break;
+        case REVERSE:
+            value = 0.35;
+            break;
+        case SKIP:
+            value = 0.35;
+            break;
+        default:
+            value = 0.2 + (static_cast<int>(type) * 0.01);
+            break;
+    }
+
+    //it modifies the value based on game state
+    if (handSize <= 3) {
+        value *= 1.5;
+    }
+    else if (handSize > 7) {
+        if (type == DRAW_TWO || type == WILD_DRAW_FOUR) {
+            value *= 1.3;
+        }
+    }
+    return value;
+}
+
+//it is the defending rule of LPOptimizer::calcDefendingValue
+constexpr double defendingValueRule(cardValue type, int opponentHandSize) {
+    double value = 0.0;
+
+    //it makes wild cards excellent for defense
+    if (type == WILD || type == WILD_DRAW_FOUR) {
+        value = 0.8;
+    }
+    else if (type == DRAW_TWO) {
+        value = 0.6;
+    }
+    else {
+        value = 0.2;
+    }
+
+    //it boosts value if opponent is close to winning
+    if (opponentHandSize <= 2) {
+        if (type == DRAW_TWO || type == WILD_DRAW_FOUR) {
+            value *= 1.5;
+        }
+    }
+    return value;
+}
+
+// ------ BUCKETS ------------ BUCKETS ------------ BUCKETS ------------ BUCKETS ------------ BUCKETS ------------ BUCKETS ------
+
+//they are the hand size buckets of each rule, split at the thresholds the rule checks
+//the first hand size of each bucket is the one the table is filled with
+const int UTILITY_HAND_BUCKETS = 3;     //it is <= 2, 3 to 5 and > 5
+const int OPPONENT_HAND_BUCKETS = 2;    //it is <= 2 and > 2
+const int ATTACKING_HAND_BUCKETS = 3;   //it is <= 3, 4 to 7 and > 7
+
+constexpr int UTILITY_BUCKET_HAND[UTILITY_HAND_BUCKETS] = { 2, 3, 6 };
+constexpr int OPPONENT_BUCKET_HAND[OPPONENT_HAND_BUCKETS] = { 2, 3 };
+constexpr int ATTACKING_BUCKET_HAND[ATTACKING_HAND_BUCKETS] = { 3, 4, 8 };
+
+constexpr int utilityHandBucket(int handSize) {
+    return (handSize > 2) + (handSize > 5);
+}
+
+constexpr int opponentHandBucket(int opponentHandSize) {
+    return opponentHandSize > 2;
+}
+
+constexpr int attackingHandBucket(int handSize) {
+    return (handSize > 3) + (handSize > 7);
+}
+
+// ------ TABLES ------------ TABLES ------------ TABLES ------------ TABLES ------------ TABLES ------------ TABLES ------
+
+using UtilityTable = std::array<std::array<std::array<double, OPPONENT_HAND_BUCKETS>, UTILITY_HAND_BUCKETS>, CARD_TYPES>;
+using AttackingTable = std::array<std::array<double, ATTACKING_HAND_BUCKETS>, CARD_TYPES>;
+using DefendingTable = std::array<std::array<double, OPPONENT_HAND_BUCKETS>, CARD_TYPES>;
+
+//it is also called at runtime to build the table of a tuned weight vector
+constexpr UtilityTable makeUtilityTable(const AIWeightVector& weights = DEFAULT_AI_WEIGHTS) {
+    UtilityTable table{};
+    for (int t = 0; t < CARD_TYPES; t++) {
+        for (int h = 0; h < UTILITY_HAND_BUCKETS; h++) {
+            for (int o = 0; o < OPPONENT_HAND_BUCKETS; o++) {
+                table[t][h][o] = cardUtilityRule(static_cast<cardValue>(t), UTILITY_BUCKET_HAND[h], OPPONENT_BUCKET_HAND[o], weights);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr AttackingTable makeAttackingTable() {
+    AttackingTable table{};
+    for (int t = 0; t < CARD_TYPES; t++) {
+        for (int h = 0; h < ATTACKING_HAND_BUCKETS; h++) {
+            table[t][h] = attackingValueRule(static_cast<cardValue>(t), ATTACKING_BUCKET_HAND[h]);
+        }
+    }
+    return table;
+}
+
+constexpr DefendingTable makeDefendingTable() {
+    DefendingTable table{};
+    for (int t = 0; t < CARD_TYPES; t++) {
+        for (int o = 0; o < OPPONENT_HAND_BUCKETS; o++) {
+            table[t][o] = defendingValueRule(static_cast<cardValue>(t), OPPONENT_BUCKET_HAND[o]);
+        }
+    }
+    return table;
+}
+
+constexpr UtilityTable CARD_UTILITY_TABLE = makeUtilityTable();
+constexpr AttackingTable ATTACKING_VALUE_TABLE = makeAttackingTable();
+constexpr DefendingTable DEFENDING_VALUE_TABLE = makeDefendingTable();
+
+constexpr double cardUtilityLookup(cardValue type, int handSize, int opponentHandSize) {
+    return CARD_UTILITY_TABLE[type][utilityHandBucket(handSize)][opponentHandBucket(opponentHandSize)];
+}
+
+constexpr double attackingValueLookup(cardValue type, int handSize) {
+    return ATTACKING_VALUE_TABLE[type][attackingHandBucket(handSize)];
+}
+
+constexpr double defendingValueLookup(cardValue type, int opponentHandSize) {
+    return DEFENDING_VALUE_TABLE[type][opponentHandBucket(opponentHandSize)];
+}
+
+// ------ CHECKS ------------ CHECKS ------------ CHECKS ------------ CHECKS ------------ CHECKS ------------ CHECKS ------
+
+//they are the hand sizes the checks cover, from below zero (the planner looks at hands after the cards it plans)
+//up to every card in the deck
+const int CHECK_MIN_HAND = -MAX_PLAN_DEPTH;
+const int CHECK_MAX_HAND = DECK_SIZE;
+
+//it checks one card type at a time so each check is its own constant evaluation and stays under the compilers step limit
+constexpr bool utilityTableMatchesRule(cardValue type) {
+    for (int h = CHECK_MIN_HAND; h <= CHECK_MAX_HAND; h++) {
+        for (int o = CHECK_MIN_HAND; o <= CHECK_MAX_HAND; o++) {
+            if (cardUtilityLookup(type, h, o) != cardUtilityRule(type, h, o)) return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool attackingTableMatchesRule(cardValue type) {
+    for (int h = CHECK_MIN_HAND; h <= CHECK_MAX_HAND; h++) {
+        if (attackingValueLookup(type, h) != attackingValueRule(type, h)) return false;
+    }
+    return true;
+}
+
+constexpr bool defendingTableMatchesRule(cardValue type) {
+    for (int o = CHECK_MIN_HAND; o <= CHECK_MAX_HAND; o++) {
+        if (defendingValueLookup(type, o) != defendingValueRule(type, o)) return false;
+    }
+    return true;
+}
+
+template <size_t... Types>
+constexpr bool everyTypeMatches(std::index_sequence<Types...>) {
+    return (std::bool_constant<utilityTableMatchesRule(static_cast<cardValue>(Types))>::value && ...)
+        && (std::bool_constant<attackingTableMatchesRule(static_cast<cardValue>(Types))>::value && ...)
+        && (std::bool_constant<defendingTableMatchesRule(static_cast<cardValue>(Types))>::value && ...);
+}
+
+static_assert(everyTypeMatches(std::make_index_sequence<CARD_TYPES>()),
+              "the score tables do not match the score rules");
+
+#endif
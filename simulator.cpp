@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batchgame.h"
+#include "decisioncache.h"
+#include "deck.h"
+#include "gamerecord.h"
+#include "instrument.h"
+#include "strategy.h"
+
+//it is the headless self-play simulator so the AI can be evaluated without a window
+//usage: UnoSimulator [--threads N] [--seed S] [--infinite-deck 0|1] [--record file]
+//                    [--budget-us U] [--budget-nodes N] [--stats file.json]
+//                    [--cache-entries N] [--cache-buckets B] [--cache-file file] [numGames] [strategy for each seat...]
+//       UnoSimulator --replay file
+//       UnoSimulator [--seed S] [--infinite-deck 0|1] --check-batch numSeats [numGames]
+//       UnoSimulator [--seed S] [--infinite-deck 0|1] --check-alloc numSeats [numGames]
+//       UnoSimulator [--seed S] [--infinite-deck 0|1] --check-snapshot numSeats [numGames]
+//the strategies are any name in the StrategyRegistry: greedy, lp, advanced, mip, ismcts and anytime
+//--budget-us and --budget-nodes set the per-move budget of the anytime strategy
+//--check-batch plays random games on both Game and BatchGames, checks that they stay the same, and times both
+//--check-alloc checks that the AI decisions make no heap allocations once the first games have warmed them up
+//--check-snapshot plays random games on both Game and GameSnapshot and checks that they stay the same and that undo works
+//--stats writes the hot-path timers and counters, which are only recorded in a build with UNO_INSTRUMENT
+//--cache-entries turns on the decision cache that every thread shares, --cache-buckets sets how finely it rounds
+//the opponent model (0 is exact), and --cache-file loads the cache before the run and saves it after
+using namespace std;
+
+//it is the turn limit so a stuck game can never hang the run
+const int MAX_TURNS_PER_GAME = 5000;
+
+//it is how many games a worker thread claims at once so threads rarely touch the shared counter
+const int GAMES_PER_CHUNK = 64;
+
+// ------ ALLOCATIONS ------------ ALLOCATIONS ------------ ALLOCATIONS ------------ ALLOCATIONS ------------ ALLOCATIONS ------
+
+//it counts the heap allocations of the calling thread, which --check-alloc reads around every AI decision
+//the array forms of new and delete call these, so every allocation of the simulator goes through them
+static thread_local long long allocationsOnThisThread = 0;
+
+void* operator new(size_t size) {
+    allocationsOnThisThread++;
+    if (void* memory = malloc(size > 0 ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    allocationsOnThisThread++;
+    size_t align = static_cast<size_t>(alignment);
+    size = (max<size_t>(size, 1) + align - 1) / align * align; //it rounds up since aligned_alloc wants a multiple
+#ifdef _MSC_VER
+    void* memory = _aligned_malloc(size, align);
+#else
+    void* memory = aligned_alloc(align, size);
+#endif
+    if (memory) return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+#ifdef _MSC_VER
+void operator delete(void* memory, align_val_t) noexcept { _aligned_free(memory); }
+void operator delete(void* memory, size_t, align_val_t) noexcept { _aligned_free(memory); }
+#else
+void operator delete(void* memory, align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, align_val_t) noexcept { free(memory); }
+#endif
+
+//it is the results of one worker thread which are only merged after all threads finish
+struct SimResults {
+    vector<long long> winsPerSeat;
+    long long totalTurns = 0;
+    long long unfinishedGames = 0;
+};
+
+//it plays one complete game where the deck is seeded from the master seed plus the game index
+void playGame(Game& game, const vector<int>& seatStrategies, int gameIndex,
+              unsigned int masterSeed, bool infiniteDeck, SimResults& results) {
+    const StrategyRegistry& registry = StrategyRegistry::instance();
+    int numSeats = seatStrategies.size();
+    game.setInfiniteDeck(infiniteDeck);
+    game.initialize(numSeats, numSeats, masterSeed + gameIndex);
+
+    //it rotates the strategies around the table so no strategy always goes first
+    vector<int> seatOwner(numSeats);
+    for (int s = 0; s < numSeats; s++) {
+        seatOwner[s] = (s + gameIndex) % numSeats;
+        game.getPlayer(s).setStrategy(seatStrategies[seatOwner[s]]);
+    }
+
+    //it gives the strategies that are random a seed from the game and turn so a game is the same every run
+    int turns = 0;
+    while (game.getState() == GAME_PLAYING && turns < MAX_TURNS_PER_GAME) {
+        game.playTurn(registry.chooseMove(game, masterSeed + gameIndex * 7919u + turns));
+        turns++;
+    }
+    results.totalTurns += turns;
+
+    if (game.getState() == GAME_OVER && game.getWinner() >= 0) {
+        results.winsPerSeat[seatOwner[game.getWinner()]]++;
+    }
+    else {
+        results.unfinishedGames++;
+    }
+}
+
+//it is how many games the batch check plays in lockstep at once
+const int CHECK_BATCH_SIZE = 1024;
+
+//it picks a uniformly random legal move, counting the draw, from a legal mask the same way BatchGames::stepRandom does
+static int pickRandomMove(uint64_t mask, FastRng& policy) {
+    int choices = popcount(mask);
+    int pick = policy.below(choices + 1);
+    if (pick == choices) return BATCH_DRAW_MOVE;
+    for (int i = 0; i < pick; i++) mask &= mask - 1;
+    return countr_zero(mask);
+}
+
+//it checks that a Game and one game of a batch are in the same state, leaving out the piles in infinite mode
+//where Game keeps every played card and BatchGames keeps none
+static bool sameState(const Game& game, const BatchGames& batch, int lane, bool infiniteDeck) {
+    if (game.getState() != batch.getState(lane) || game.getWinner() != batch.getWinner(lane)) return false;
+    if (game.getCurrentPlayerIndex() != batch.getCurrentSeat(lane) || game.isClockwise() != batch.isClockwise(lane)) return false;
+    if (game.getDrawStack() != batch.getDrawStack(lane)) return false;
+    Card top = game.getTopCard();
+    if (top.color != batch.getTopCard(lane).color || top.type != batch.getTopCard(lane).type) return false;
+    if (!infiniteDeck && (game.getDeckSize() != batch.getPileSize(lane) || game.getDiscardSize() != batch.getDiscardSize(lane))) return false;
+    for (int seat = 0; seat < batch.getNumSeats(); seat++) {
+        const HandCounts& counts = game.getPlayers()[seat].getHandCounts();
+        if (counts.present != batch.getHandMask(lane, seat) || counts.total != batch.getHandSize(lane, seat)) return false;
+        for (int slot = 0; slot < HAND_SLOTS; slot++) {
+            if (counts.counts[slot] != batch.getHandCount(lane, seat, slot)) return false;
+        }
+    }
+    return true;
+}
+
+//it plays the same seeds and the same random moves on Game and on BatchGames and counts the games that differ
+int checkBatch(int numGames, int numSeats, unsigned int masterSeed, bool infiniteDeck) {
+    if (numSeats < 2 || numSeats > MAX_SEATS) {
+        cerr << "--check-batch needs 2 to " << MAX_SEATS << " seats" << endl;
+        return 1;
+    }
+
+    long long totalMoves = 0;
+    int mismatches = 0;
+    vector<Game> games(CHECK_BATCH_SIZE);
+    vector<FastRng> policies(CHECK_BATCH_SIZE);
+    vector<bool> matching(CHECK_BATCH_SIZE);
+    vector<uint64_t> masks(CHECK_BATCH_SIZE);
+    vector<int> moves(CHECK_BATCH_SIZE);
+    for (int first = 0; first < numGames; first += CHECK_BATCH_SIZE) {
+        int lanes = min(CHECK_BATCH_SIZE, numGames - first);
+        BatchGames batch(lanes, numSeats, infiniteDeck);
+        batch.resetAll(masterSeed + first);
+        for (int lane = 0; lane < lanes; lane++) {
+            games[lane].setInfiniteDeck(infiniteDeck);
+            games[lane].initialize(numSeats, numSeats, masterSeed + first + lane);
+            FastRng generator(masterSeed + first + lane);
+            generator.split();
+            policies[lane] = generator;
+            matching[lane] = sameState(games[lane], batch, lane, infiniteDeck);
+        }
+
+        for (int turn = 0; turn < MAX_TURNS_PER_GAME && batch.getActiveCount() > 0; turn++) {
+            batch.legalMasks(masks.data());
+            for (int lane = 0; lane < lanes; lane++) {
+                moves[lane] = BATCH_DRAW_MOVE;
+                if (!matching[lane] || batch.getState(lane) != GAME_PLAYING) continue;
+                moves[lane] = pickRandomMove(masks[lane], policies[lane]);
+
+                //it plays the first copy of the slot in the Game hand, which has the same card in it
+                Game& game = games[lane];
+                const vector<Card>& hand = game.getCurrentPlayer().getHand();
+                int cardIndex = -1;
+                for (int i = 0; moves[lane] != BATCH_DRAW_MOVE && i < (int)hand.size(); i++) {
+                    if (HandCounts::slotOf(hand[i]) == moves[lane]) {
+                        cardIndex = i;
+                        break;
+                    }
+                }
+                game.playTurn(cardIndex);
+                totalMoves++;
+            }
+            batch.step(moves.data());
+            for (int lane = 0; lane < lanes; lane++) {
+                if (matching[lane] && !sameState(games[lane], batch, lane, infiniteDeck)) matching[lane] = false;
+            }
+        }
+        for (int lane = 0; lane < lanes; lane++) {
+            mismatches += !matching[lane];
+        }
+    }
+    cout << "games: " << numGames << "  seats: " << numSeats << "  moves: " << totalMoves
+         << "  mismatches: " << mismatches << endl;
+
+    //it times the same random games on both engines, the batch ones all in lockstep
+    auto startTime = chrono::steady_clock::now();
+    long long gameTurns = 0;
+    Game game;
+    for (int g = 0; g < numGames; g++) {
+        game.setInfiniteDeck(infiniteDeck);
+        game.initialize(numSeats, numSeats, masterSeed + g);
+        FastRng policy(masterSeed + g);
+        policy.split();
+        for (int turn = 0; turn < MAX_TURNS_PER_GAME && game.getState() == GAME_PLAYING; turn++, gameTurns++) {
+            const Player& player = game.getCurrentPlayer();
+            uint64_t mask = player.getHandCounts().playable(game.getTopCard());
+            if (game.getDrawStack() > 0) mask &= HandCounts::typeMask(DRAW_TWO) | HandCounts::typeMask(WILD_DRAW_FOUR);
+            int move = pickRandomMove(mask, policy);
+            int cardIndex = -1;
+            for (int i = 0; move != BATCH_DRAW_MOVE && i < player.getHandSize(); i++) {
+                if (HandCounts::slotOf(player.getHand()[i]) == move) {
+                    cardIndex = i;
+                    break;
+                }
+            }
+            game.playTurn(cardIndex);
+        }
+    }
+    double gameSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    startTime = chrono::steady_clock::now();
+    BatchGames batch(numGames, numSeats, infiniteDeck);
+    batch.resetAll(masterSeed);
+    batch.playRandom(MAX_TURNS_PER_GAME);
+    double batchSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    long long batchTurns = 0;
+    for (int g = 0; g < numGames; g++) batchTurns += batch.getTurns(g);
+
+    cout << "Game: " << numGames / gameSeconds << " games/sec, " << gameTurns / gameSeconds << " turns/sec" << endl;
+    cout << "BatchGames: " << numGames / batchSeconds << " games/sec, " << batchTurns / batchSeconds << " turns/sec" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//it checks that a Game and a snapshot are in the same state, leaving out the piles in infinite mode
+//where Game keeps every played card and the snapshot only counts them
+static bool sameState(const Game& game, const GameSnapshot& snapshot) {
+    if (game.getState() != snapshot.state || game.getWinner() != snapshot.winner) return false;
+    if (game.getCurrentPlayerIndex() != snapshot.currentPlayer || game.isClockwise() != snapshot.clockwise) return false;
+    if (game.getDrawStack() != snapshot.drawStack || game.getTopCard().pack() != snapshot.topCard.pack()) return false;
+    if (!snapshot.infinite && (game.getDeckSize() != snapshot.pileSize || game.getDiscardSize() != snapshot.discardSize)) return false;
+    for (int seat = 0; seat < snapshot.numPlayers; seat++) {
+        const HandCounts& counts = game.getPlayers()[seat].getHandCounts();
+        if (counts.total != snapshot.hands[seat].total) return false;
+        if (memcmp(counts.counts, snapshot.hands[seat].counts, HAND_SLOTS) != 0) return false;
+    }
+    if (!snapshot.infinite) {
+        const vector<Card>& pile = game.getDeck().getCards();
+        for (int i = 0; i < snapshot.pileSize; i++) {
+            if (pile[i].pack() != snapshot.pile[i]) return false;
+        }
+    }
+    return true;
+}
+
+//it checks that undo brought a snapshot back, looking only at the part of the draw pile in use
+static bool sameSnapshot(const GameSnapshot& a, const GameSnapshot& b) {
+    if (a.currentPlayer != b.currentPlayer || a.drawStack != b.drawStack || a.winner != b.winner) return false;
+    if (a.state != b.state || a.clockwise != b.clockwise || a.topCard.pack() != b.topCard.pack()) return false;
+    if (a.pileSize != b.pileSize || a.discardSize != b.discardSize) return false;
+    if (memcmp(&a.rng, &b.rng, sizeof(FastRng)) != 0) return false;
+    if (memcmp(a.discard, b.discard, sizeof(a.discard)) != 0 || memcmp(a.pile, b.pile, a.pileSize) != 0) return false;
+    for (int seat = 0; seat < a.numPlayers; seat++) {
+        if (a.hands[seat].total != b.hands[seat].total || a.hands[seat].present != b.hands[seat].present) return false;
+        if (memcmp(a.hands[seat].counts, b.hands[seat].counts, HAND_SLOTS) != 0) return false;
+    }
+    return true;
+}
+
+//it plays the same seeds and the same random moves on Game::playTurn and on GameSnapshot::apply, takes every
+//move back with undo and plays it again, and counts the games where either one differs
+//a reshuffle orders the discard pile by slot in the snapshot and by play order in Game, so the cards drawn after
+//one differ, and a move that reshuffles is only checked for undo before the snapshot is saved from the Game again
+int checkSnapshot(int numGames, int numSeats, unsigned int masterSeed, bool infiniteDeck) {
+    if (numSeats < 2 || numSeats > MAX_SNAPSHOT_PLAYERS) {
+        cerr << "--check-snapshot needs 2 to " << MAX_SNAPSHOT_PLAYERS << " seats" << endl;
+        return 1;
+    }
+
+    long long totalMoves = 0;
+    long long reshuffles = 0;
+    int mismatches = 0;
+    Game game;
+    GameSnapshot snapshot;
+    GameSnapshot before;
+    SnapshotUndo undo;
+    int moves[HAND_SLOTS + 1];
+    for (int g = 0; g < numGames; g++) {
+        game.setInfiniteDeck(infiniteDeck);
+        game.initialize(numSeats, numSeats, masterSeed + g);
+        FastRng policy(masterSeed + g);
+        policy.split();
+        bool matching = game.saveSnapshot(snapshot) && sameState(game, snapshot);
+        for (int turn = 0; turn < MAX_TURNS_PER_GAME && matching && game.getState() == GAME_PLAYING; turn++) {
+            int move = moves[policy.below(snapshot.legalMoves(moves))];
+            before = snapshot;
+            if (!snapshot.apply(move, undo)) {
+                matching = false;
+                break;
+            }
+            snapshot.undo(undo);
+            if (!sameSnapshot(snapshot, before)) {
+                matching = false;
+                break;
+            }
+            snapshot.apply(move, undo);
+            bool reshuffled = undo.reshuffled;
+
+            //it plays the first copy of the slot in the Game hand, which has the same card in it
+            const vector<Card>& hand = game.getCurrentPlayer().getHand();
+            int cardIndex = -1;
+            for (int i = 0; move != SNAPSHOT_DRAW_MOVE && i < (int)hand.size(); i++) {
+                if (HandCounts::slotOf(hand[i]) == move) {
+                    cardIndex = i;
+                    break;
+                }
+            }
+            game.playTurn(cardIndex);
+            totalMoves++;
+
+            if (reshuffled) {
+                game.saveSnapshot(snapshot);
+                reshuffles++;
+            }
+            matching = sameState(game, snapshot);
+        }
+        mismatches += !matching;
+    }
+    cout << "games: " << numGames << "  seats: " << numSeats << "  moves: " << totalMoves
+         << "  reshuffles: " << reshuffles << "  mismatches: " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//it is how many games --check-alloc plays before it counts, so the per-thread tables and buffers reach their size
+const int CHECK_ALLOC_WARMUP_GAMES = 200;
+
+//it plays games with the planner and asks chooseOptimalCard, chooseOptimalCardMultiTurn and
+//chooseOptimalCardAdvanced for every move, and after the warm-up games any allocation in them is a failure
+int checkAllocations(int numGames, int numSeats, unsigned int masterSeed, bool infiniteDeck) {
+    if (numSeats < 2 || numSeats > MAX_SEATS) {
+        cerr << "--check-alloc needs 2 to " << MAX_SEATS << " seats" << endl;
+        return 1;
+    }
+
+    const char* names[3] = { "chooseOptimalCard", "chooseOptimalCardMultiTurn", "chooseOptimalCardAdvanced" };
+    long long allocations[3] = { 0, 0, 0 };
+    long long decisions = 0;
+    int firstFailingGame = -1;
+    Game game;
+    for (int g = 0; g < CHECK_ALLOC_WARMUP_GAMES + numGames; g++) {
+        bool counting = g >= CHECK_ALLOC_WARMUP_GAMES;
+        game.setInfiniteDeck(infiniteDeck);
+        game.initialize(numSeats, numSeats, masterSeed + g);
+        for (int turn = 0; turn < MAX_TURNS_PER_GAME && game.getState() == GAME_PLAYING; turn++) {
+            Player& player = game.getPlayer(game.getCurrentPlayerIndex());
+            const Card& top = game.getTopCard();
+            int nextSeat = Game::seatAfter(game.getCurrentPlayerIndex(), game.isClockwise(), numSeats);
+            int opponentHandSize = game.getPlayers()[nextSeat].getHandSize();
+
+            long long before[4];
+            before[0] = allocationsOnThisThread;
+            player.chooseOptimalCard(top, opponentHandSize);
+            before[1] = allocationsOnThisThread;
+            player.chooseOptimalCardMultiTurn(top, opponentHandSize, 1);
+            before[2] = allocationsOnThisThread;
+            int move = player.chooseOptimalCardAdvanced(top, opponentHandSize, 3);
+            before[3] = allocationsOnThisThread;
+
+            if (counting) {
+                decisions++;
+                for (int f = 0; f < 3; f++) allocations[f] += before[f + 1] - before[f];
+                if (before[3] != before[0] && firstFailingGame == -1) firstFailingGame = g;
+            }
+            game.playTurn(applyDrawStackRule(game, move));
+        }
+    }
+
+    cout << "games: " << numGames << " (after " << CHECK_ALLOC_WARMUP_GAMES << " warm-up games)  seats: " << numSeats
+         << "  decisions: " << decisions << endl;
+    bool failed = false;
+    for (int f = 0; f < 3; f++) {
+        cout << names[f] << ": " << allocations[f] << " allocations" << endl;
+        failed = failed || allocations[f] != 0;
+    }
+    if (failed) {
+        cerr << "an AI decision allocated after the warm-up, first in game " << firstFailingGame << endl;
+        return 1;
+    }
+    return 0;
+}
+
+//it replays every game of a record file and checks that each one ends with the recorded winner
+int replayRecords(const string& path) {
+    GameRecordReader reader;
+    if (!reader.open(path)) {
+        cerr << "can not read record file: " << path << endl;
+        return 1;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+    Game game;
+    long long totalMoves = 0;
+    int mismatches = 0;
+    for (int g = 0; g < reader.getGameCount(); g++) {
+        GameRecord record;
+        reader.readGame(g, record);
+        totalMoves += record.numMoves;
+        if (!reader.replay(g, game)) {
+            mismatches++;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "games: " << reader.getGameCount() << "  moves: " << totalMoves
+         << "  mismatches: " << mismatches << "  time: " << seconds << " s" << endl;
+    cout << "games/sec: " << reader.getGameCount() / seconds << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int numGames = 1000;
+    int numThreads = 1;
+    unsigned int masterSeed = random_device{}();
+    bool infiniteDeck = false;
+    string recordPath;
+    string statsPath;
+    int checkSeats = 0;
+    int checkAllocSeats = 0;
+    int checkSnapshotSeats = 0;
+    size_t cacheEntries = 0;
+    int cacheBuckets = DECISION_CACHE_MODEL_BUCKETS;
+    string cachePath;
+    vector<int> seatStrategies;
+    AnytimeStrategy anytime = get<AnytimeStrategy>(StrategyRegistry::instance().get(StrategyRegistry::ANYTIME));
+    const StrategyRegistry& registry = StrategyRegistry::instance();
+
+    //it reads the options, the number of games and the strategy for each seat
+    int arg = 1;
+    while (arg < argc && string(argv[arg]).rfind("--", 0) == 0) {
+        string option = argv[arg];
+        if (arg + 1 >= argc) {
+            cerr << option << " needs a value" << endl;
+            return 1;
+        }
+        if (option == "--threads") {
+            numThreads = atoi(argv[arg + 1]);
+            if (numThreads <= 0) {
+                numThreads = max(1u, thread::hardware_concurrency()); //it uses every core for 0
+            }
+        }
+        else if (option == "--seed") {
+            masterSeed = strtoul(argv[arg + 1], nullptr, 10);
+        }
+        else if (option == "--infinite-deck") {
+            infiniteDeck = atoi(argv[arg + 1]) != 0;
+        }
+        else if (option == "--record") {
+            recordPath = argv[arg + 1];
+        }
+        else if (option == "--check-batch") {
+            checkSeats = atoi(argv[arg + 1]);
+        }
+        else if (option == "--check-alloc") {
+            checkAllocSeats = atoi(argv[arg + 1]);
+        }
+        else if (option == "--check-snapshot") {
+            checkSnapshotSeats = atoi(argv[arg + 1]);
+        }
+        else if (option == "--stats") {
+            statsPath = argv[arg + 1];
+        }
+        else if (option == "--budget-us") {
+            anytime.budget.timeBudgetUs = atof(argv[arg + 1]);
+        }
+        else if (option == "--budget-nodes") {
+            anytime.budget.nodeBudget = atoll(argv[arg + 1]);
+        }
+        else if (option == "--cache-entries") {
+            cacheEntries = strtoull(argv[arg + 1], nullptr, 10);
+        }
+        else if (option == "--cache-buckets") {
+            cacheBuckets = atoi(argv[arg + 1]);
+        }
+        else if (option == "--cache-file") {
+            cachePath = argv[arg + 1];
+        }
+        else if (option == "--replay") {
+            return replayRecords(argv[arg + 1]);
+        }
+        else {
+            cerr << "unknown option: " << option << endl;
+            return 1;
+        }
+        arg += 2;
+    }
+    StrategyRegistry::instance().add("anytime", anytime);
+
+    if (checkSeats != 0) {
+        return checkBatch(arg < argc ? atoi(argv[arg]) : numGames, checkSeats, masterSeed, infiniteDeck);
+    }
+    if (checkAllocSeats != 0) {
+        return checkAllocations(arg < argc ? atoi(argv[arg]) : numGames, checkAllocSeats, masterSeed, infiniteDeck);
+    }
+    if (checkSnapshotSeats != 0) {
+        return checkSnapshot(arg < argc ? atoi(argv[arg]) : numGames, checkSnapshotSeats, masterSeed, infiniteDeck);
+    }
+
+    if (arg < argc) {
+        numGames = atoi(argv[arg]);
+        if (numGames <= 0) {
+            cerr << "numGames must be a positive number" << endl;
+            return 1;
+        }
+        arg++;
+    }
+    for (; arg < argc; arg++) {
+        int strategy = registry.find(argv[arg]);
+        if (strategy == -1) {
+            cerr << "unknown strategy: " << argv[arg] << " (use";
+            for (const auto& name : registry.getNames()) cerr << " " << name;
+            cerr << ")" << endl;
+            return 1;
+        }
+        seatStrategies.push_back(strategy);
+    }
+    //it defaults to the advanced AI playing against the greedy AI
+    if (seatStrategies.size() < 2) {
+        seatStrategies = { StrategyRegistry::PLANNER, StrategyRegistry::GREEDY };
+    }
+
+    int numSeats = seatStrategies.size();
+    vector<SimResults> threadResults(numThreads);
+    for (auto& results : threadResults) {
+        results.winsPerSeat.assign(numSeats, 0);
+    }
+    atomic<int> nextGame(0);
+
+    DecisionCache& cache = DecisionCache::instance();
+    cache.configure(cacheEntries, cacheBuckets);
+    if (!cachePath.empty() && cache.isEnabled() && !cache.load(cachePath)) {
+        cerr << "starting with an empty decision cache, could not load: " << cachePath << endl;
+    }
+
+    GameRecordFile recordFile;
+    if (!recordPath.empty() && !recordFile.open(recordPath)) {
+        cerr << "can not write record file: " << recordPath << endl;
+        return 1;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+
+    //it gives every thread its own game and lets it claim chunks of game indices until none are left
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&, t]() {
+            Game game;
+            GameRecordWriter writer(recordFile);
+            if (recordFile.isOpen()) {
+                game.setRecorder(&writer);
+            }
+            SimResults& results = threadResults[t];
+            while (true) {
+                int first = nextGame.fetch_add(GAMES_PER_CHUNK, memory_order_relaxed);
+                if (first >= numGames) break;
+                int last = min(first + GAMES_PER_CHUNK, numGames);
+                for (int g = first; g < last; g++) {
+                    playGame(game, seatStrategies, g, masterSeed, infiniteDeck, results);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    recordFile.close();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    //it merges the results of every thread now that they are all done
+    SimResults total;
+    total.winsPerSeat.assign(numSeats, 0);
+    for (const auto& results : threadResults) {
+        total.totalTurns += results.totalTurns;
+        total.unfinishedGames += results.unfinishedGames;
+        for (int s = 0; s < numSeats; s++) {
+            total.winsPerSeat[s] += results.winsPerSeat[s];
+        }
+    }
+
+    //it prints the throughput and the win rates
+    cout << "games: " << numGames << "  turns: " << total.totalTurns
+         << "  unfinished: " << total.unfinishedGames << "  time: " << seconds << " s" << endl;
+    cout << "threads: " << numThreads << "  seed: " << masterSeed << endl;
+    cout << "games/sec: " << numGames / seconds << endl;
+    cout << "turns/sec: " << total.totalTurns / seconds << endl;
+    for (int s = 0; s < numSeats; s++) {
+        cout << "player " << s << " (" << registry.getName(seatStrategies[s]) << "): "
+             << total.winsPerSeat[s] << " wins, "
+             << (100.0 * total.winsPerSeat[s] / numGames) << "% win rate" << endl;
+    }
+    if (cache.isEnabled()) {
+        DecisionCacheStats cacheStats = cache.stats();
+        cout << "decision cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses ("
+             << 100.0 * cacheStats.hitRate() << "% hit rate), " << cacheStats.entries << "/" << cacheStats.capacity
+             << " entries, " << cacheStats.evictions << " evictions" << endl;
+        if (!cachePath.empty() && !cache.save(cachePath)) {
+            cerr << "can not write decision cache file: " << cachePath << endl;
+            return 1;
+        }
+    }
+
+    //it writes the timers and counters now that every worker thread has ended and merged its own
+    if (!statsPath.empty()) {
+        ofstream stats(statsPath);
+        if (!stats) {
+            cerr << "can not write stats file: " << statsPath << endl;
+            return 1;
+        }
+        Instrumentation::writeJson(stats);
+        if (!Instrumentation::isEnabled()) {
+            cerr << "this build has no instrumentation, configure with -DUNO_INSTRUMENT=ON to record it" << endl;
+        }
+    }
+    return 0;
+}
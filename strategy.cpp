@@ -0,0 +1,132 @@
+#include "strategy.h"
+#include <algorithm>
+
+using namespace std;
+
+//it gets the hand of the player who moves next, which is the seat a draw card or a skip hits
+//the planners read the rest of the table from the table model of the player
+static int nextOpponentHandSize(const Game& game) {
+    const vector<Player>& players = game.getPlayers();
+    return players[Game::seatAfter(game.getCurrentPlayerIndex(), game.isClockwise(), players.size())].getHandSize();
+}
+
+//it only lets a card be played onto a draw stack when it is another draw card
+int applyDrawStackRule(const Game& game, int cardToPlay) {
+    if (cardToPlay != -1 && game.getDrawStack() > 0) {
+        const Card& selectedCard = game.getCurrentPlayer().getHand()[cardToPlay];
+        if (selectedCard.type != DRAW_TWO && selectedCard.type != WILD_DRAW_FOUR) {
+            return -1;
+        }
+    }
+    return cardToPlay;
+}
+
+int GreedyStrategy::chooseCard(Game& game, unsigned int) const {
+    return game.getCurrentPlayer().chooseOptimalCard(game.getTopCard(), nextOpponentHandSize(game));
+}
+
+int LPStrategy::chooseCard(Game& game, unsigned int) const {
+    return game.getCurrentPlayer().chooseOptimalCardMultiTurn(game.getTopCard(), nextOpponentHandSize(game), 1);
+}
+
+int PlannerStrategy::chooseCard(Game& game, unsigned int) const {
+    return game.getCurrentPlayer().chooseOptimalCardAdvanced(game.getTopCard(), nextOpponentHandSize(game), turnsAhead);
+}
+
+int MIPStrategy::chooseCard(Game& game, unsigned int) const {
+    return game.getCurrentPlayer().chooseOptimalCardMIP(game.getTopCard(), nextOpponentHandSize(game),
+                                                        turnsAhead, timeBudgetUs);
+}
+
+int AnytimeStrategy::chooseCard(Game& game, unsigned int) const {
+    return game.getCurrentPlayer().chooseOptimalCardAnytime(game.getTopCard(), nextOpponentHandSize(game), budget);
+}
+
+int EndgameStrategy::chooseCard(Game& game, unsigned int) const {
+    const Player& player = game.getCurrentPlayer();
+    int opponentHandSize = nextOpponentHandSize(game);
+    if (!EndgameSolver::applies(player.getHandSize(), opponentHandSize, config)) {
+        return player.chooseOptimalCardAdvanced(game.getTopCard(), opponentHandSize, config.fallbackTurnsAhead);
+    }
+
+    //it tells the solver which cards are in the discard pile, which only a real deck keeps
+    HandCounts discarded;
+    if (!game.isInfiniteDeck()) discarded = HandCounts(game.getDiscardPile().getCards());
+    return EndgameSolver::solve(player.getHand(), game.getTopCard(), game.getDrawStack(), opponentHandSize,
+                                player.getOpponentModel(), game.isInfiniteDeck() ? nullptr : &discarded,
+                                config).cardIndex;
+}
+
+int ISMCTSStrategy::chooseCard(Game& game, unsigned int seed) const {
+    ISMCTSConfig seeded = config;
+    seeded.seed = seed;
+    return ISMCTS::search(game, seeded).cardIndex;
+}
+
+//it registers the built-in strategies in the order of BuiltinId
+StrategyRegistry::StrategyRegistry() {
+    add("greedy", GreedyStrategy());
+    add("lp", LPStrategy());
+    add("advanced", PlannerStrategy());
+    add("mip", MIPStrategy());
+
+    //it keeps the tree search small by default so it can be used in the simulator
+    ISMCTSStrategy ismcts;
+    ismcts.config.iterations = 200;
+    add("ismcts", ismcts);
+
+    //it gives every move the same 200 microseconds so batch runs have a fixed cost per move
+    AnytimeStrategy anytime;
+    anytime.budget.timeBudgetUs = 200.0;
+    add("anytime", anytime);
+
+    add("endgame", EndgameStrategy());
+}
+
+//it gets the registry shared by the whole program
+StrategyRegistry& StrategyRegistry::instance() {
+    static StrategyRegistry registry;
+    return registry;
+}
+
+//it adds a strategy or replaces the one with the same name
+int StrategyRegistry::add(const string& name, const StrategyVariant& strategy) {
+    int id = find(name);
+    if (id != -1) {
+        strategies[id] = strategy;
+        return id;
+    }
+    names.push_back(name);
+    strategies.push_back(strategy);
+    return strategies.size() - 1;
+}
+
+//it wraps a runtime strategy and adds it
+int StrategyRegistry::add(const string& name, shared_ptr<const Strategy> strategy) {
+    return add(name, StrategyVariant(CustomStrategy{ strategy }));
+}
+
+//it finds the id of a strategy by name
+int StrategyRegistry::find(const string& name) const {
+    for (int i = 0; i < (int)names.size(); i++) {
+        if (names[i] == name) return i;
+    }
+    return -1;
+}
+
+//it gets a strategy by id and falls back to the planner the game has always used
+const StrategyVariant& StrategyRegistry::get(int id) const {
+    if (id < 0 || id >= (int)strategies.size()) return strategies[PLANNER];
+    return strategies[id];
+}
+
+//it gets the name of a strategy by id
+const string& StrategyRegistry::getName(int id) const {
+    if (id < 0 || id >= (int)names.size()) return names[PLANNER];
+    return names[id];
+}
+
+//it picks the move of the current player with the strategy that player was given
+int StrategyRegistry::chooseMove(Game& game, unsigned int seed) const {
+    return chooseMoveWith(get(game.getCurrentPlayer().getStrategy()), game, seed);
+}
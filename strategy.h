@@ -0,0 +1,127 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+#include "deck.h"
+#include "endgame.h"
+#include "ismcts.h"
+
+//it is the base class for strategies that are added at runtime
+//the built-in strategies below do not use it so the simulation loop never makes a virtual call for them
+class Strategy {
+public:
+    virtual ~Strategy() = default;
+
+    //it returns the index in the current players hand to play or -1 to draw
+    virtual int chooseCard(Game& game, unsigned int seed) const = 0;
+};
+
+//it plays the card with the best legacy calcCard score
+struct GreedyStrategy {
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays the card picked by the single-turn GLPK model
+struct LPStrategy {
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays the first card of the multi-turn sequence plan with opponent modeling
+struct PlannerStrategy {
+    int turnsAhead = 3;
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays the first card of the multi-turn MIP plan
+struct MIPStrategy {
+    int turnsAhead = 4;
+    double timeBudgetUs = 1000.0; //it is the most time one move may take, counting the fallback plan
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays the first card of the sequence plan deepened until a per-move budget runs out
+struct AnytimeStrategy {
+    PlanBudget budget;
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays like PlannerStrategy until a hand is nearly empty, and then plays the move of the endgame solver
+struct EndgameStrategy {
+    EndgameConfig config;
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it plays the move with the most visits after an ISMCTS search
+struct ISMCTSStrategy {
+    ISMCTSConfig config;
+    int chooseCard(Game& game, unsigned int seed) const;
+};
+
+//it wraps a runtime strategy so it can be stored next to the built-in ones
+struct CustomStrategy {
+    std::shared_ptr<const Strategy> strategy;
+    int chooseCard(Game& game, unsigned int seed) const { return strategy->chooseCard(game, seed); }
+};
+
+//it is any strategy, dispatched with std::visit instead of a virtual call
+using StrategyVariant = std::variant<GreedyStrategy, LPStrategy, PlannerStrategy,
+                                     MIPStrategy, ISMCTSStrategy, AnytimeStrategy, EndgameStrategy,
+                                     CustomStrategy>;
+
+//it stops a strategy from playing onto a draw stack with anything but another draw card
+int applyDrawStackRule(const Game& game, int cardToPlay);
+
+//it picks the move with a strategy whose type is known at compile time, which batch runs use
+template <class S>
+int chooseMoveWith(const S& strategy, Game& game, unsigned int seed) {
+    return applyDrawStackRule(game, strategy.chooseCard(game, seed));
+}
+
+//it picks the move with any strategy
+inline int chooseMoveWith(const StrategyVariant& strategy, Game& game, unsigned int seed) {
+    int cardToPlay = std::visit([&](const auto& s) { return s.chooseCard(game, seed); }, strategy);
+    return applyDrawStackRule(game, cardToPlay);
+}
+
+//it is the named list of strategies a Player can be given by id
+//the built-in ones are registered first, so their ids never change
+class StrategyRegistry {
+private:
+    std::vector<std::string> names;
+    std::vector<StrategyVariant> strategies;
+
+    StrategyRegistry();
+
+public:
+    //it is the id of each built-in strategy
+    enum BuiltinId { GREEDY, LP, PLANNER, MIP, ISMCTS_SEARCH, ANYTIME, ENDGAME };
+
+    //it gets the registry shared by the whole program
+    static StrategyRegistry& instance();
+
+    //it adds a strategy or replaces the one with the same name and returns its id
+    int add(const std::string& name, const StrategyVariant& strategy);
+
+    //it adds a runtime strategy and returns its id
+    int add(const std::string& name, std::shared_ptr<const Strategy> strategy);
+
+    //it finds the id of a strategy by name or returns -1
+    int find(const std::string& name) const;
+
+    //it gets a strategy by id, and the default planner for -1 or an unknown id
+    const StrategyVariant& get(int id) const;
+
+    //it gets the name of a strategy by id
+    const std::string& getName(int id) const;
+
+    //it gets every registered name in id order
+    const std::vector<std::string>& getNames() const { return names; }
+
+    //it picks the move of the current player with the strategy that player was given
+    int chooseMove(Game& game, unsigned int seed) const;
+};
+
+#endif
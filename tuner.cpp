@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aiweights.h"
+#include "deck.h"
+#include "strategy.h"
+
+//it is the parallel tuner of the AI weights (scoretables.h), which improves them with SPSA over self-play
+//usage: UnoTuner [--threads N] [--seed S] [--games N] [--iterations K] [--strategy name] [--tune name,name...]
+//                [--step a] [--perturb c] [--eval-every K] [--eval-games N] [--checkpoint file]
+//every candidate plays the strategy with its weights against the same strategy with the default weights
+//the games of an evaluation are common random numbers: every candidate plays the same deals from both seats,
+//so the two sides of an SPSA step only differ where their moves differ
+//every weight is moved relative to its default, so one step size fits a wild worth 10 and a point bonus of 0.1
+//--checkpoint writes the iteration and the weights after every iteration and carries on from them when the file exists
+//it prints the evaluated games/sec of every iteration and of the whole run
+using namespace std;
+
+//it is the turn limit so a stuck game can never hang the run
+const int MAX_TURNS_PER_GAME = 5000;
+
+//it is how many games a worker thread claims at once so threads rarely touch the shared counter
+const int GAMES_PER_CHUNK = 16;
+
+//it is where the deals of the progress evaluations start, far from the ones the iterations play
+const unsigned int HOLDOUT_SEED_OFFSET = 0x40000000u;
+
+//they are the SPSA gain exponents from Spall's guidelines
+const double SPSA_STEP_DECAY = 0.602;
+const double SPSA_PERTURB_DECAY = 0.101;
+
+//it is the SPSA A, which keeps the first steps small, and is a tenth of the default iterations as Spall suggests
+//it does not follow --iterations so a run resumed with more iterations takes the same steps
+const double SPSA_STABILITY = 10.0;
+
+//it is the settings of a tuning run
+struct TunerConfig {
+    int numThreads = max(1u, thread::hardware_concurrency());
+    unsigned int seed = 1;
+    int gamesPerCandidate = 2000;   //it is rounded up to an even number so every deal is played from both seats
+    int iterations = 100;
+    int strategyId = StrategyRegistry::PLANNER;
+    vector<bool> tuned = vector<bool>(AI_WEIGHT_COUNT, true);
+    double step = 1.0;              //it is the SPSA a, the step size of the first iteration before it decays
+    double perturb = 0.2;           //it is the SPSA c, how far each weight is moved relative to its default
+    int evalEvery = 10;
+    int evalGames = 4000;
+    string checkpointPath;
+};
+
+//it is the outcome of one evaluation
+struct Evaluation {
+    vector<long long> wins;         //it is the wins of each candidate against the defaults
+    long long gamesPerCandidate;
+    long long turns;
+    double seconds;
+
+    double winRate(int candidate) const { return wins[candidate] / (double)gamesPerCandidate; }
+};
+
+//it builds the weights of a candidate
+AIWeights weightsAt(const vector<double>& values) {
+    AIWeightVector weights;
+    copy(values.begin(), values.end(), weights.begin());
+    return AIWeights(weights);
+}
+
+//it is how far a weight moves for a relative step of 1
+double weightScale(int w) {
+    return fabs(DEFAULT_AI_WEIGHTS[w]);
+}
+
+//it plays one game of the candidate against the defaults and returns true when the candidate wins
+bool playGame(Game& game, const StrategyVariant& strategy, int strategyId, const AIWeights& candidate,
+              unsigned int seed, int candidateSeat, long long& turns) {
+    game.initialize(2, 2, seed);
+    for (int s = 0; s < 2; s++) game.getPlayer(s).setStrategy(strategyId);
+
+    int turn = 0;
+    while (game.getState() == GAME_PLAYING && turn < MAX_TURNS_PER_GAME) {
+        int move;
+        {
+            bool candidateMoves = game.getCurrentPlayerIndex() == candidateSeat;
+            AIWeights::Scope scope(candidateMoves ? candidate : AIWeights::defaults());
+            move = chooseMoveWith(strategy, game, seed * 7919u + turn);
+        }
+        game.playTurn(move);
+        turn++;
+    }
+    turns += turn;
+    return game.getState() == GAME_OVER && game.getWinner() == candidateSeat;
+}
+
+//it plays every candidate against the defaults across the worker threads
+//game g of every candidate is the deal firstSeed + g / 2 with the candidate in seat g % 2
+Evaluation evaluate(const vector<AIWeights>& candidates, const TunerConfig& config, unsigned int firstSeed, int games) {
+    const StrategyVariant& strategy = StrategyRegistry::instance().get(config.strategyId);
+    int numCandidates = candidates.size();
+    long long totalGames = (long long)numCandidates * games;
+
+    //it gives every thread its own counters which are only merged after all threads finish
+    vector<vector<long long>> threadWins(config.numThreads, vector<long long>(numCandidates, 0));
+    vector<long long> threadTurns(config.numThreads, 0);
+    atomic<long long> nextGame(0);
+
+    auto startTime = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < config.numThreads; t++) {
+        workers.emplace_back([&, t]() {
+            Game game;
+            while (true) {
+                long long first = nextGame.fetch_add(GAMES_PER_CHUNK, memory_order_relaxed);
+                if (first >= totalGames) break;
+                long long last = min(first + GAMES_PER_CHUNK, totalGames);
+
+                //it runs the candidates side by side so a chunk plays the same deals for each of them
+                for (long long task = first; task < last; task++) {
+                    int candidate = task % numCandidates;
+                    int g = task / numCandidates;
+                    if (playGame(game, strategy, config.strategyId, candidates[candidate],
+                                 firstSeed + g / 2, g % 2, threadTurns[t])) {
+                        threadWins[t][candidate]++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Evaluation result;
+    result.wins.assign(numCandidates, 0);
+    result.gamesPerCandidate = games;
+    result.turns = 0;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    for (int t = 0; t < config.numThreads; t++) {
+        result.turns += threadTurns[t];
+        for (int c = 0; c < numCandidates; c++) result.wins[c] += threadWins[t][c];
+    }
+    return result;
+}
+
+// ------ CHECKPOINT ------------ CHECKPOINT ------------ CHECKPOINT ------------ CHECKPOINT ------------ CHECKPOINT ------
+
+//it writes the next iteration, the seed and every weight by name to a new file and then renames it over the
+//checkpoint, so a run stopped while writing keeps the last checkpoint
+bool saveCheckpoint(const string& path, int nextIteration, unsigned int seed, const vector<double>& values) {
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary);
+        if (!file) return false;
+        file.precision(17);
+        file << "iteration " << nextIteration << "\n";
+        file << "seed " << seed << "\n";
+        for (int w = 0; w < AI_WEIGHT_COUNT; w++) {
+            file << AI_WEIGHT_NAMES[w] << " " << values[w] << "\n";
+        }
+        if (!file) return false;
+    }
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+//it reads a checkpoint back, leaving any weight it does not name at its default
+//17 digits give back the exact doubles, so a resumed run plays the same moves as one that never stopped
+bool loadCheckpoint(const string& path, int& nextIteration, unsigned int& seed, vector<double>& values) {
+    ifstream file(path);
+    if (!file) return false;
+
+    string line;
+    while (getline(file, line)) {
+        istringstream fields(line);
+        string name;
+        double value;
+        if (!(fields >> name >> value)) continue;
+        if (name == "iteration") {
+            nextIteration = (int)value;
+        }
+        else if (name == "seed") {
+            seed = (unsigned int)value;
+        }
+        else {
+            int w = AIWeights::find(name);
+            if (w == -1) {
+                cerr << "ignoring unknown weight in checkpoint: " << name << endl;
+                continue;
+            }
+            values[w] = value;
+        }
+    }
+    return true;
+}
+
+// ------ TUNING ------------ TUNING ------------ TUNING ------------ TUNING ------------ TUNING ------------ TUNING ------
+
+//it plays the weights against the defaults on deals no iteration uses and prints the win rate with its 95% interval
+void reportProgress(const vector<double>& values, const TunerConfig& config, long long& totalGames, double& totalSeconds) {
+    Evaluation eval = evaluate({ weightsAt(values) }, config, config.seed + HOLDOUT_SEED_OFFSET, config.evalGames);
+    totalGames += eval.gamesPerCandidate;
+    totalSeconds += eval.seconds;
+    double rate = eval.winRate(0);
+    double margin = 1.96 * sqrt(rate * (1.0 - rate) / eval.gamesPerCandidate);
+    cout << "  held-out win rate vs defaults: " << 100.0 * rate << "% +- " << 100.0 * margin
+         << "%  (" << eval.gamesPerCandidate / eval.seconds << " games/sec)" << endl;
+}
+
+//it runs SPSA: every iteration moves every tuned weight up or down by the same relative amount at random,
+//plays the two sides on the same deals and steps along the estimated gradient of the win rate
+int tune(TunerConfig config) {
+    vector<double> values(DEFAULT_AI_WEIGHTS.begin(), DEFAULT_AI_WEIGHTS.end());
+    int firstIteration = 0;
+    if (!config.checkpointPath.empty() && loadCheckpoint(config.checkpointPath, firstIteration, config.seed, values)) {
+        cout << "resuming from " << config.checkpointPath << " at iteration " << firstIteration << endl;
+    }
+
+    cout << "threads: " << config.numThreads << "  seed: " << config.seed << "  strategy: "
+         << StrategyRegistry::instance().getName(config.strategyId) << "  games per candidate: "
+         << config.gamesPerCandidate << endl;
+
+    long long totalGames = 0;
+    double totalSeconds = 0.0;
+    int pairs = config.gamesPerCandidate / 2;
+
+    for (int k = firstIteration; k < config.iterations; k++) {
+        double stepGain = config.step / pow(k + 1 + SPSA_STABILITY, SPSA_STEP_DECAY);
+        double perturbGain = config.perturb / pow(k + 1, SPSA_PERTURB_DECAY);
+
+        //it draws the directions from the seed and the iteration so a resumed run takes the same steps
+        FastRng directions((uint64_t)config.seed << 32 | (uint32_t)k);
+        vector<double> delta(AI_WEIGHT_COUNT, 0.0);
+        vector<double> plus = values;
+        vector<double> minus = values;
+        for (int w = 0; w < AI_WEIGHT_COUNT; w++) {
+            if (!config.tuned[w]) continue;
+            delta[w] = directions.below(2) ? 1.0 : -1.0;
+            plus[w] += perturbGain * delta[w] * weightScale(w);
+            minus[w] -= perturbGain * delta[w] * weightScale(w);
+        }
+
+        //it gives every iteration its own deals, which both sides share
+        Evaluation eval = evaluate({ weightsAt(plus), weightsAt(minus) }, config,
+                                   config.seed + (unsigned int)k * pairs, pairs * 2);
+        totalGames += 2 * eval.gamesPerCandidate;
+        totalSeconds += eval.seconds;
+
+        //it steps at most the perturbation, so one noisy estimate can not throw the weights far away
+        double difference = eval.winRate(0) - eval.winRate(1);
+        for (int w = 0; w < AI_WEIGHT_COUNT; w++) {
+            if (!config.tuned[w]) continue;
+            double gradient = difference / (2.0 * perturbGain * delta[w]);
+            values[w] += max(-perturbGain, min(perturbGain, stepGain * gradient)) * weightScale(w);
+        }
+
+        cout << "iteration " << k << ": plus " << 100.0 * eval.winRate(0) << "%  minus " << 100.0 * eval.winRate(1)
+             << "%  games/sec: " << 2 * eval.gamesPerCandidate / eval.seconds
+             << "  turns/sec: " << eval.turns / eval.seconds << endl;
+
+        if (!config.checkpointPath.empty() && !saveCheckpoint(config.checkpointPath, k + 1, config.seed, values)) {
+            cerr << "can not write checkpoint file: " << config.checkpointPath << endl;
+            return 1;
+        }
+        if (config.evalEvery > 0 && (k + 1) % config.evalEvery == 0 && k + 1 < config.iterations) {
+            reportProgress(values, config, totalGames, totalSeconds);
+        }
+    }
+
+    cout << "final weights:" << endl;
+    for (int w = 0; w < AI_WEIGHT_COUNT; w++) {
+        cout << "  " << AI_WEIGHT_NAMES[w] << " " << values[w] << "  (default " << DEFAULT_AI_WEIGHTS[w] << ")" << endl;
+    }
+    reportProgress(values, config, totalGames, totalSeconds);
+    cout << "evaluated games: " << totalGames << "  time: " << totalSeconds << " s  games/sec: "
+         << totalGames / totalSeconds << endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TunerConfig config;
+    const StrategyRegistry& registry = StrategyRegistry::instance();
+
+    for (int arg = 1; arg < argc; arg += 2) {
+        string option = argv[arg];
+        if (arg + 1 >= argc) {
+            cerr << option << " needs a value" << endl;
+            return 1;
+        }
+        string value = argv[arg + 1];
+        if (option == "--threads") {
+            config.numThreads = atoi(value.c_str());
+            if (config.numThreads <= 0) {
+                config.numThreads = max(1u, thread::hardware_concurrency()); //it uses every core for 0
+            }
+        }
+        else if (option == "--seed") {
+            config.seed = strtoul(value.c_str(), nullptr, 10);
+        }
+        else if (option == "--games") {
+            config.gamesPerCandidate = max(2, atoi(value.c_str()) + 1) / 2 * 2;
+        }
+        else if (option == "--iterations") {
+            config.iterations = atoi(value.c_str());
+        }
+        else if (option == "--strategy") {
+            config.strategyId = registry.find(value);
+            if (config.strategyId == -1) {
+                cerr << "unknown strategy: " << value << " (use";
+                for (const auto& name : registry.getNames()) cerr << " " << name;
+                cerr << ")" << endl;
+                return 1;
+            }
+        }
+        else if (option == "--tune") {
+            //it only moves the named weights and keeps the others at their defaults
+            config.tuned.assign(AI_WEIGHT_COUNT, false);
+            istringstream names(value);
+            string name;
+            while (getline(names, name, ',')) {
+                int w = AIWeights::find(name);
+                if (w == -1) {
+                    cerr << "unknown weight: " << name << " (use";
+                    for (const char* weightName : AI_WEIGHT_NAMES) cerr << " " << weightName;
+                    cerr << ")" << endl;
+                    return 1;
+                }
+                config.tuned[w] = true;
+            }
+        }
+        else if (option == "--step") {
+            config.step = atof(value.c_str());
+        }
+        else if (option == "--perturb") {
+            config.perturb = atof(value.c_str());
+        }
+        else if (option == "--eval-every") {
+            config.evalEvery = atoi(value.c_str());
+        }
+        else if (option == "--eval-games") {
+            config.evalGames = max(2, atoi(value.c_str()) + 1) / 2 * 2;
+        }
+        else if (option == "--checkpoint") {
+            config.checkpointPath = value;
+        }
+        else {
+            cerr << "unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    return tune(config);
+}